@@ -0,0 +1,118 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#ifndef HPP_MODEL_BATCH_COLLISION_TEST_HH
+# define HPP_MODEL_BATCH_COLLISION_TEST_HH
+
+# include <vector>
+# include <hpp/fcl/math/vec_3f.h>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+# include <hpp/model/batch-forward-kinematics.hh>
+
+namespace hpp {
+  namespace model {
+    /// Collision tests of a batch of configurations
+    ///
+    /// Joint positions are first computed in single precision for the whole
+    /// batch (see BatchForwardKinematics). Each body is then tested against
+    /// its collision outer objects with bounding spheres:
+    /// \li the sphere of a body is centered at the origin of its joint with
+    ///     radius Body::radius,
+    /// \li the sphere of an outer object attached to a joint of the device
+    ///     is the sphere of the body holding it,
+    /// \li the sphere of another outer object is the bounding sphere of its
+    ///     geometry at its current position.
+    ///
+    /// Configurations for which all spheres are separated by more than
+    /// margin are collision-free. Other configurations are tested in
+    /// double precision by Device::collisionTest (const DeviceData&), so
+    /// that results are the same as the results of this method.
+    ///
+    /// The kinematic chain and the collision objects of the device are read
+    /// when the instance is created. If they are modified afterwards, a new
+    /// instance should be created.
+    class HPP_MODEL_DLLAPI BatchCollisionTest
+    {
+    public:
+      /// Create an instance for a device
+      static BatchCollisionTestPtr_t create (const DeviceConstPtr_t& device);
+
+      /// Test collision of a batch of configurations
+      /// \param configurations matrix of size N x Device::configSize, each
+      ///        row of which is a configuration of the robot,
+      /// \retval collisions whether each configuration is in collision,
+      ///         resized to N.
+      void compute (matrixIn_t configurations, std::vector <bool>& collisions);
+
+      /// Set margin between bounding spheres
+      ///
+      /// The margin should be larger than the rounding errors of joint
+      /// positions computed in single precision. Default value is 1e-4.
+      void margin (const value_type& margin)
+      {
+	margin_ = margin;
+      }
+      /// Get margin between bounding spheres
+      const value_type& margin () const
+      {
+	return margin_;
+      }
+
+      /// Number of configurations tested in double precision by last call to
+      /// compute
+      size_type numberConfirmed () const
+      {
+	return numberConfirmed_;
+      }
+
+    protected:
+      BatchCollisionTest (const DeviceConstPtr_t& device);
+
+    private:
+      /// Pair of bounding spheres
+      struct Pair_t {
+	/// Rank of joint holding the body
+	size_type rank;
+	/// Rank of joint holding the outer object, -1 if the outer object is
+	/// not attached to the device
+	size_type outerRank;
+	/// Center of outer object bounding sphere if outerRank is -1
+	fcl::Vec3f center;
+	/// Sum of the radii of the spheres
+	value_type radius;
+      }; // struct Pair_t
+      typedef std::vector <Pair_t> Pairs_t;
+      typedef Eigen::Array <float, 1, Eigen::Dynamic> Row_t;
+
+      DeviceConstPtr_t device_;
+      BatchForwardKinematicsPtr_t forwardKinematics_;
+      DeviceDataPtr_t data_;
+      Pairs_t pairs_;
+      value_type margin_;
+      size_type numberConfirmed_;
+      BatchForwardKinematics::PlacementBatchf_t placements_;
+      /// Squared distance between centers of spheres
+      Row_t squaredDistance_;
+      /// Whether some spheres are closer than margin
+      Eigen::Array <bool, 1, Eigen::Dynamic> near_;
+    }; // class BatchCollisionTest
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_BATCH_COLLISION_TEST_HH
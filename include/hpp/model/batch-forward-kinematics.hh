@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_MODEL_BATCH_FORWARD_KINEMATICS_HH
+# define HPP_MODEL_BATCH_FORWARD_KINEMATICS_HH
+
+# include <vector>
+# include <hpp/fcl/math/transform.h>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+# include <hpp/model/kinematic-tree.hh>
+
+namespace hpp {
+  namespace model {
+    /// Forward kinematics of a batch of configurations
+    ///
+    /// Compute the position of all joints of a device for N configurations
+    /// at once. Joint positions are stored in a structure of arrays
+    /// (see PlacementBatch_t) so that each elementary operation of a joint
+    /// is applied to the whole batch in a single vectorized loop.
+    ///
+    /// The kinematic tree of the device (see Device::kinematicTree) is
+    /// copied when the object is created. If joints are added to the device
+    /// afterwards, a new instance should be created.
+    ///
+    /// Joint positions can be computed in single precision, which doubles
+    /// the number of configurations processed by each vector instruction.
+    ///
+    /// \note Joints of type JOINT_GENERIC are evaluated configuration by
+    /// configuration using Joint::computePosition.
+    class HPP_MODEL_DLLAPI BatchForwardKinematics
+    {
+    public:
+      /// Joint positions of a batch of configurations
+      ///
+      /// For the joint of rank \f$i\f$ (see method rank), rows
+      /// \f$12i\f$ to \f$12i+8\f$ store the coefficients of the rotation
+      /// matrix in row-major order, rows \f$12i+9\f$ to \f$12i+11\f$ store
+      /// the translation. Column \f$j\f$ corresponds to the \f$j\f$-th
+      /// configuration of the batch.
+      typedef Eigen::Matrix <value_type, Eigen::Dynamic, Eigen::Dynamic,
+			     Eigen::RowMajor> PlacementBatch_t;
+      /// Joint positions of a batch of configurations in single precision
+      /// \sa PlacementBatch_t
+      typedef Eigen::Matrix <float, Eigen::Dynamic, Eigen::Dynamic,
+			     Eigen::RowMajor> PlacementBatchf_t;
+
+      /// Create an instance for a device
+      static BatchForwardKinematicsPtr_t create (const DeviceConstPtr_t&
+						 device);
+
+      /// Compute joint positions for a batch of configurations
+      /// \param configurations matrix of size N x Device::configSize, each
+      ///        row of which is a configuration of the robot,
+      /// \retval placements joint positions for each configuration,
+      ///         resized to 12 x number of joints rows and N columns if
+      ///         necessary.
+      void compute (matrixIn_t configurations, PlacementBatch_t& placements);
+
+      /// Compute joint positions for a batch of configurations in single
+      /// precision
+      /// \param configurations matrix of size N x Device::configSize, each
+      ///        row of which is a configuration of the robot,
+      /// \retval placements joint positions for each configuration,
+      ///         resized to 12 x number of joints rows and N columns if
+      ///         necessary.
+      void compute (matrixIn_t configurations, PlacementBatchf_t& placements);
+
+      /// Rank of a joint in the batch of placements
+      ///
+      /// Joints are stored in the order of the kinematic tree of the device.
+      /// \throw std::runtime_error if joint does not belong to the device.
+      size_type rank (const JointConstPtr_t& joint) const;
+
+      /// Get position of a joint for one configuration of the batch
+      /// \param placements result of method compute,
+      /// \param rank rank of the joint (see method rank),
+      /// \param index index of the configuration in the batch.
+      static Transform3f placement (const PlacementBatch_t& placements,
+				    size_type rank, size_type index);
+      /// Get position of a joint for one configuration of the batch
+      /// \sa placement (const PlacementBatch_t&, size_type, size_type)
+      static Transform3f placement (const PlacementBatchf_t& placements,
+				    size_type rank, size_type index);
+
+    protected:
+      BatchForwardKinematics (const DeviceConstPtr_t& device);
+
+    private:
+      /// Generic joints are evaluated from genericConfigurations, other
+      /// joints from configurations in the precision of Batch.
+      template <typename Configurations, typename Batch>
+      void computeBatch (matrixIn_t genericConfigurations,
+			 const Configurations& configurations,
+			 Batch& placements, Batch& work) const;
+      template <typename Batch>
+      void computeParentProduct (const KinematicTree::Node_t& node,
+				 const Batch& placements, Batch& work) const;
+      template <typename Batch>
+      void computeGeneric (size_type rank, matrixIn_t configurations,
+			   Batch& placements) const;
+      KinematicTree tree_;
+      size_type configSize_;
+      /// Product of parent position by position in parent frame (rows 0 to
+      /// 11) and joint motion (rows 12 to 20).
+      PlacementBatch_t work_;
+      PlacementBatchf_t workf_;
+      /// Configurations converted to single precision
+      Eigen::Matrix <float, Eigen::Dynamic, Eigen::Dynamic> configurationsf_;
+    }; // class BatchForwardKinematics
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_BATCH_FORWARD_KINEMATICS_HH
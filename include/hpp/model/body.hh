@@ -52,7 +52,11 @@ namespace hpp {
       /// inner and outer object lists are filled with copies of the objects
       /// contained in the lists of this. (See CollisionObject::clone).
       BodyPtr_t clone (const JointPtr_t& joint) const;
-      virtual ~Body () {}
+      /// Destructor
+      ///
+      /// Removes the collision obstacles of the body from the obstacle trees
+      /// of the devices.
+      virtual ~Body ();
       /// @}
 
       /// \name Name
@@ -120,6 +124,10 @@ namespace hpp {
       /// \param distance  whether this object should be considered for
       ///        distance computation
       /// \note If object is already in body, do nothing.
+      /// \note Collision objects that are not attached to a joint are
+      ///       static obstacles: if the body belongs to a device, they are
+      ///       stored in the obstacle tree of the device (see
+      ///       Device::obstacles).
       /// \warning Added objects by this method will be unknown from the
       ///         Device and will not be reset by it
       virtual void addOuterObject (const CollisionObjectPtr_t& object,
@@ -144,9 +152,27 @@ namespace hpp {
 
       /// Test for collision
       /// \return true if collision, false if no collision
+      ///
+      /// Objects attached to the joints of the device are placed at the
+      /// current joint positions first (see Device::updateGeometry). Pairs
+      /// of objects the bounding spheres of which are separated are rejected
+      /// without calling fcl::collide. Collision obstacles are tested
+      /// through the obstacle tree of the device.
       bool collisionTest () const;
 
+      /// Test for collision and count tested pairs of objects
+      /// \retval numberPairs incremented by the number of pairs of objects
+      ///         tested,
+      /// \retval numberCulled incremented by the number of pairs rejected by
+      ///         bounding spheres or by the obstacle tree.
+      /// \return true if collision, false if no collision
+      bool collisionTest (size_type& numberPairs, size_type& numberCulled)
+	const;
+
       /// Compute distances between pairs of objects stored in bodies
+      ///
+      /// Objects attached to the joints of the device are placed at the
+      /// current joint positions first.
       void computeDistances (DistanceResults_t& results,
 			     DistanceResults_t::size_type& offset);
 
@@ -191,11 +217,30 @@ namespace hpp {
 
       ///  @}
     private:
+      friend class Device;
+      friend class Joint;
       void updateRadius (const CollisionObjectPtr_t& object);
+      /// Remove a collision obstacle of the body from the obstacle trees of
+      /// the devices holding it
+      void removeObstacle (const CollisionObjectPtr_t& object) const;
+      /// Remove the collision obstacles of the body from the obstacle trees
+      /// of the devices and keep them as mobile outer objects
+      ///
+      /// Called when the body is destroyed or detached from its joint.
+      void unregisterObstacles ();
+      /// Place the inner and outer objects attached to the joints of the
+      /// device for a type of request
+      void placeObjects (Request_t type) const;
       ObjectVector_t collisionInnerObjects_;
       ObjectVector_t collisionOuterObjects_;
       ObjectVector_t distanceInnerObjects_;
       ObjectVector_t distanceOuterObjects_;
+      /// Collision outer objects that are not stored in the obstacle tree
+      /// of the device
+      ObjectVector_t collisionOuterMobileObjects_;
+      /// Number of collision outer objects stored in the obstacle tree of
+      /// the device
+      size_type numberCollisionObstacles_;
       JointPtr_t joint_;
       std::string name_;
       /// Inertial information
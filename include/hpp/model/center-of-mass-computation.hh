@@ -17,24 +17,53 @@
 #ifndef HPP_MODEL_CENTER_OF_MASS_COMPUTATION_HH
 # define HPP_MODEL_CENTER_OF_MASS_COMPUTATION_HH
 
-# include <list>
+# include <vector>
 
 # include <hpp/model/fwd.hh>
 # include <hpp/model/device.hh>
 
 namespace hpp {
   namespace model {
+    /// Center of mass of a subset of the bodies of a device
+    ///
+    /// The subset is made of the subtrees rooted at the joints passed to
+    /// method add. Selected joints are stored in the depth-first order of
+    /// the kinematic tree of the device (see Device::kinematicTree) so that
+    /// the center of mass is accumulated in a single backward pass over
+    /// contiguous arrays. The kinematic chain of the device should be
+    /// complete when the instance is created.
+    ///
+    /// Positions of the joints are read from the data of the device or
+    /// from a DeviceData instance. Masses of the bodies are read
+    /// by computeMass, which should be called after adding joints and after
+    /// modifying the bodies.
     class CenterOfMassComputation
     {
       public:
 
         static CenterOfMassComputationPtr_t create (const DevicePtr_t& device);
 
+        /// Add the subtree rooted at a joint
+        /// \throw std::runtime_error if the joint does not belong to the
+        ///        device.
         void add (const JointPtr_t& joint);
 
+        /// Compute center of mass and Jacobian at the joint positions
+        /// computed by Device::computeForwardKinematics ()
         void compute (const Device::Computation_t& flag
             = Device::ALL);
 
+        /// Compute center of mass and Jacobian at the joint positions
+        /// stored in data
+        /// \param data result of
+        ///        Device::computeForwardKinematics (DeviceData&),
+        /// \param flag Device::COM and/or Device::JACOBIAN.
+        ///
+        /// The device is not read: several instances can compute
+        /// concurrently, each with its own data.
+        void compute (const DeviceData& data,
+                      const Device::Computation_t& flag = Device::ALL);
+
         const fcl::Vec3f& com () const
         {
           return com_;
@@ -45,6 +74,7 @@ namespace hpp {
           return mass_;
         }
 
+        /// Read masses of the bodies and compute masses of the subtrees
         void computeMass ();
 
         const ComJacobian_t& jacobian () const
@@ -58,15 +88,22 @@ namespace hpp {
         CenterOfMassComputation (const DevicePtr_t& device);
 
       private:
-        // Keep a tree structure in order to compute a partial COM
-        struct JointTreeElement_t;
-        struct isJoint;
-
-        typedef std::list <JointTreeElement_t*> JointTreeList;
-        // JointTreeElement_t s that have no parents
-        JointTreeList rootJointTrees_;
-        // all JointTreeElement_t s
-        JointTreeList jointTrees_;
+        DevicePtr_t device_;
+        /// Whether each joint of the kinematic tree is selected
+        std::vector <bool> selected_;
+        /// Ranks in the kinematic tree of the selected joints
+        std::vector <size_type> ranks_;
+        /// Index in ranks_ of the parent of each selected joint, -1 if the
+        /// parent is not selected
+        std::vector <size_type> parents_;
+        /// Mass and local center of mass of the body of each selected joint
+        std::vector <value_type> bodyMasses_;
+        std::vector <fcl::Vec3f> localComs_;
+        /// Mass of the subtree rooted at each selected joint
+        std::vector <value_type> masses_;
+        /// Mass times center of mass of the subtree rooted at each selected
+        /// joint
+        std::vector <fcl::Vec3f> massComs_;
 
         value_type mass_;
         vector3_t massCom_;
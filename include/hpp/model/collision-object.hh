@@ -20,6 +20,7 @@
 #ifndef HPP_MODEL_COLLISION_OBJECT_HH
 # define HPP_MODEL_COLLISION_OBJECT_HH
 
+# include <vector>
 # include <hpp/fcl/collision_object.h>
 # include <hpp/util/pointer.hh>
 # include <hpp/model/config.hh>
@@ -65,6 +66,8 @@ namespace hpp {
       /// Return transform of the fcl object
       /// \warning If joint linked object -as a robot body- and the robot is
       /// manually moved, this will return the non-update transform.
+      /// Transforms of objects linked to joints are updated by
+      /// Device::updateGeometry.
       /// \note If object is not attached to a joint, use move() to update
       /// transform between hpp and fcl.
       const fcl::Transform3f& getTransform () const
@@ -74,6 +77,9 @@ namespace hpp {
 
       /// Move object to given position
       /// \note If object is attached to a joint, throw exception.
+      ///
+      /// If the object is a collision obstacle of some devices (see
+      /// Device::obstacles), their obstacle trees are updated.
       void move (const Transform3f& position);
 
     protected:
@@ -84,7 +90,7 @@ namespace hpp {
       /// Wrap fcl collision object at identity position
       explicit CollisionObject (fcl::CollisionObjectPtr_t object,
 				const std::string& name) :
-	object_ (object), joint_ (0), name_ (name), weakPtr_ ()
+	object_ (object), joint_ (0), name_ (name), devices_ (), weakPtr_ ()
 	{
 	  positionInJointFrame_.setIdentity ();
 	}
@@ -93,7 +99,7 @@ namespace hpp {
 				const Transform3f& position,
 				const std::string& name) :
 	object_ (new fcl::CollisionObject (geometry, position)),
-	joint_ (0), name_ (name), weakPtr_ ()
+	joint_ (0), name_ (name), devices_ (), weakPtr_ ()
 	{
 	  positionInJointFrame_ = position;
 	}
@@ -104,6 +110,7 @@ namespace hpp {
 	positionInJointFrame_ (object.positionInJointFrame_),
 	joint_ (0x0),
 	name_ (object.name_),
+	devices_ (),
 	weakPtr_ ()
 	  {
 	  }
@@ -119,7 +126,11 @@ namespace hpp {
       fcl::Transform3f positionInJointFrame_;
       JointPtr_t joint_;
       std::string name_;
+      /// Devices the obstacle tree of which holds the object
+      std::vector <DeviceWkPtr_t> devices_;
       CollisionObjectWkPtr_t weakPtr_;
+      friend class Body;
+      friend class Device;
     }; // class CollisionObject
   } // namespace model
 } // namespace hpp
@@ -40,11 +40,11 @@ namespace hpp {
     ///
     /// \note bounded degrees of freedom are saturated if the result of the
     ///       above operation is beyond a bound.
-    inline void integrate  (const DevicePtr_t& robot,
+    inline void integrate  (const Device& robot,
 			    ConfigurationIn_t configuration,
 			    vectorIn_t velocity, ConfigurationOut_t result)
     {
-      const JointVector_t& jv (robot->getJointVector ());
+      const JointVector_t& jv (robot.getJointVector ());
       for (model::JointVector_t::const_iterator itJoint = jv.begin ();
 	   itJoint != jv.end (); itJoint++) {
 	size_type indexConfig = (*itJoint)->rankInConfiguration ();
@@ -55,6 +55,17 @@ namespace hpp {
       }
     }
 
+    /// Integrate a constant velocity during unit time.
+    ///
+    /// \sa integrate (const Device&, ConfigurationIn_t, vectorIn_t,
+    ///                 ConfigurationOut_t)
+    inline void integrate  (const DevicePtr_t& robot,
+			    ConfigurationIn_t configuration,
+			    vectorIn_t velocity, ConfigurationOut_t result)
+    {
+      integrate (*robot, configuration, velocity, result);
+    }
+
     /// Interpolate between two configurations of the robot
     /// \param robot robot that describes the kinematic chain
     /// \param q0, q1, two configurations to interpolate
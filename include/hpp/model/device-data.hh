@@ -0,0 +1,438 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_MODEL_DEVICE_DATA_HH
+# define HPP_MODEL_DEVICE_DATA_HH
+
+# include <map>
+# include <vector>
+# include <hpp/fcl/math/transform.h>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+# include <hpp/model/device.hh>
+# include <hpp/model/joint.hh>
+# include <hpp/model/sparse-jacobian.hh>
+
+namespace hpp {
+  namespace model {
+    /// Values computed by forward kinematics
+    ///
+    /// A Device describes the kinematic chain, the bodies and the geometry
+    /// of a robot. An instance of this class stores the quantities that
+    /// depend on the configuration: joint positions, joint Jacobians and
+    /// center of mass. Since the following methods do not modify the device,
+    /// they can be called concurrently on the same device with one instance
+    /// of this class per thread:
+    /// \li Device::computeForwardKinematics (DeviceData&) const,
+    /// \li Device::collisionTest (const DeviceData&) const,
+    /// \li Device::computeDistances (const DeviceData&, DistanceResults_t&)
+    ///     const.
+    ///
+    /// The kinematic chain of the device should be complete when the
+    /// instance is created. If joints are added to the device afterwards,
+    /// a new instance should be created. The device should not be deleted
+    /// before the instance.
+    ///
+    /// Joint positions are computed by Device::computeForwardKinematics.
+    /// Jacobians, center of mass, velocities and accelerations are
+    /// computed by the same
+    /// method if selected by controlComputation, or on first access
+    /// otherwise.
+    ///
+    /// \note Joints of type JOINT_GENERIC (see KinematicTree) are evaluated
+    /// through the virtual methods of Joint and are thread safe only if
+    /// these methods are.
+    class HPP_MODEL_DLLAPI DeviceData
+    {
+    public:
+      /// Frame in which Jacobians of frames and points are expressed
+      enum Frame_t {
+	/// World frame
+	WORLD,
+	/// Frame attached to the joint (see frameJacobian and pointJacobian)
+	LOCAL
+      };
+
+      /// Create data for a device
+      ///
+      /// The current configuration is initialized with the current
+      /// configuration of the device.
+      static DeviceDataPtr_t create (const DeviceConstPtr_t& device);
+
+      /// \name Configuration
+      /// \{
+
+      /// Get current configuration
+      const Configuration_t& currentConfiguration () const
+      {
+	return configuration_;
+      }
+      /// Set current configuration
+      /// \return True if the current configuration was modified and false if
+      ///         the current configuration did not change.
+      bool currentConfiguration (ConfigurationIn_t configuration);
+      /// Get current velocity
+      const vector_t& currentVelocity () const
+      {
+	return velocity_;
+      }
+      /// Set current velocity
+      void currentVelocity (vectorIn_t velocity);
+      /// Get current acceleration
+      const vector_t& currentAcceleration () const
+      {
+	return acceleration_;
+      }
+      /// Set current acceleration
+      void currentAcceleration (vectorIn_t acceleration);
+
+      /// Select values computed with joint positions
+      /// \sa Device::controlComputation
+      void controlComputation (const Device::Computation_t& flag);
+      /// Get computation flag
+      Device::Computation_t computationFlag () const
+      {
+	return computationFlag_;
+      }
+      /// \}
+
+      /// \name Results of forward kinematics
+      /// \{
+
+      /// Get position of a joint
+      const Transform3f& position (const JointConstPtr_t& joint) const
+      {
+	return positions_ [joint->rankInTree ()];
+      }
+      /// Get Jacobian of a joint
+      ///
+      /// Computed on first access after Device::computeForwardKinematics.
+      /// \throw std::runtime_error if the joint does not belong to the
+      ///        kinematic tree of the device.
+      const JointJacobian_t& jacobian (const JointConstPtr_t& joint) const
+      {
+	const size_type rank = rankInTree (joint);
+	if (!jacobiansUpToDate_ [rank]) {
+	  device_->computeJointJacobian (*this, rank);
+	}
+	return jacobians_ [rank];
+      }
+      /// Get Jacobian of a joint
+      ///
+      /// Computed on first access after Device::computeForwardKinematics.
+      JointJacobian_t& jacobian (const JointConstPtr_t& joint)
+      {
+	const size_type rank = rankInTree (joint);
+	if (!jacobiansUpToDate_ [rank]) {
+	  device_->computeJointJacobian (*this, rank);
+	}
+	return jacobians_ [rank];
+      }
+      /// Compute Jacobian of a frame attached to a joint
+      /// \param joint the joint,
+      /// \param positionInJoint position of the frame in the joint frame,
+      /// \param frame frame in which the Jacobian is expressed: WORLD or the
+      ///        attached frame,
+      /// \retval jacobian matrix of size 6 x number of degrees of freedom
+      ///         of the kinematic chain. The first three rows store the
+      ///         linear velocity of the frame origin, the last three rows
+      ///         the angular velocity of the frame.
+      ///
+      /// Uses the Jacobian of the joint, computed if not up to date. Does
+      /// not allocate memory.
+      void frameJacobian (const JointConstPtr_t& joint,
+			  const Transform3f& positionInJoint, Frame_t frame,
+			  matrixOut_t jacobian) const;
+      /// Compute Jacobian of a point attached to a joint
+      /// \param joint the joint,
+      /// \param pointInJoint coordinates of the point in the joint frame,
+      /// \param frame frame in which the Jacobian is expressed: WORLD or the
+      ///        joint frame,
+      /// \retval jacobian matrix of size 3 x number of degrees of freedom
+      ///         of the kinematic chain storing the linear velocity of the
+      ///         point.
+      ///
+      /// Uses the Jacobian of the joint, computed if not up to date. Does
+      /// not allocate memory.
+      void pointJacobian (const JointConstPtr_t& joint,
+			  const fcl::Vec3f& pointInJoint, Frame_t frame,
+			  matrixOut_t jacobian) const;
+      /// Get Jacobian of a joint restricted to its support
+      ///
+      /// Computed on first access after Device::computeForwardKinematics.
+      /// Unlike method jacobian, only stores the columns of the degrees of
+      /// freedom that move the joint.
+      const SparseJacobian& sparseJacobian (const JointConstPtr_t& joint)
+	const
+      {
+	const size_type rank = rankInTree (joint);
+	if (!sparseJacobiansUpToDate_ [rank]) {
+	  device_->computeSparseJointJacobian (*this, rank);
+	}
+	return sparseJacobians_ [rank];
+      }
+      /// Get position of center of mass
+      ///
+      /// Computed on first access after Device::computeForwardKinematics.
+      const vector3_t& positionCenterOfMass () const
+      {
+	if (!comUpToDate_) device_->computePositionCenterOfMass (*this);
+	return com_;
+      }
+      /// Get Jacobian of center of mass with respect to configuration
+      ///
+      /// Computed on first access after Device::computeForwardKinematics.
+      const ComJacobian_t& jacobianCenterOfMass () const
+      {
+	if (!jacobianComUpToDate_) {
+	  device_->computeJacobianCenterOfMass (*this);
+	}
+	return jacobianCom_;
+      }
+
+      /// Get linear velocity of the origin of a joint in world frame
+      ///
+      /// Computed on first access after Device::computeForwardKinematics
+      /// from the current velocity.
+      const fcl::Vec3f& linearVelocity (const JointConstPtr_t& joint) const
+      {
+	if (!velocitiesUpToDate_) device_->computeVelocities (*this);
+	return linearVelocities_ [joint->rankInTree ()];
+      }
+      /// Get angular velocity of a joint in world frame
+      ///
+      /// Computed on first access after Device::computeForwardKinematics
+      /// from the current velocity.
+      const fcl::Vec3f& angularVelocity (const JointConstPtr_t& joint) const
+      {
+	if (!velocitiesUpToDate_) device_->computeVelocities (*this);
+	return angularVelocities_ [joint->rankInTree ()];
+      }
+      /// Get velocity of center of mass
+      ///
+      /// Computed on first access after Device::computeForwardKinematics
+      /// from the current velocity.
+      const vector3_t& velocityCenterOfMass () const
+      {
+	if (!comVelocityUpToDate_) device_->computeVelocityCenterOfMass (*this);
+	return comVelocity_;
+      }
+      /// Get linear acceleration of the origin of a joint in world frame
+      ///
+      /// Computed on first access after Device::computeForwardKinematics
+      /// from the current velocity and acceleration.
+      const fcl::Vec3f& linearAcceleration (const JointConstPtr_t& joint)
+	const
+      {
+	if (!accelerationsUpToDate_) device_->computeAccelerations (*this);
+	return linearAccelerations_ [joint->rankInTree ()];
+      }
+      /// Get angular acceleration of a joint in world frame
+      ///
+      /// Computed on first access after Device::computeForwardKinematics
+      /// from the current velocity and acceleration.
+      const fcl::Vec3f& angularAcceleration (const JointConstPtr_t& joint)
+	const
+      {
+	if (!accelerationsUpToDate_) device_->computeAccelerations (*this);
+	return angularAccelerations_ [joint->rankInTree ()];
+      }
+      /// Get acceleration of center of mass
+      ///
+      /// Computed on first access after Device::computeForwardKinematics
+      /// from the current velocity and acceleration.
+      const vector3_t& accelerationCenterOfMass () const
+      {
+	if (!comAccelerationUpToDate_) {
+	  device_->computeAccelerationCenterOfMass (*this);
+	}
+	return comAcceleration_;
+      }
+      /// Get linear part of \f$\dot{J}\dot{q}\f$ for a joint
+      ///
+      /// This is the linear acceleration of the joint origin for the
+      /// current velocity and a zero acceleration. Computed on first access
+      /// after Device::computeForwardKinematics.
+      const fcl::Vec3f& linearDrift (const JointConstPtr_t& joint) const
+      {
+	if (!driftsUpToDate_) device_->computeDrifts (*this);
+	return linearDrifts_ [joint->rankInTree ()];
+      }
+      /// Get angular part of \f$\dot{J}\dot{q}\f$ for a joint
+      ///
+      /// This is the angular acceleration of the joint for the current
+      /// velocity and a zero acceleration. Computed on first access after
+      /// Device::computeForwardKinematics.
+      const fcl::Vec3f& angularDrift (const JointConstPtr_t& joint) const
+      {
+	if (!driftsUpToDate_) device_->computeDrifts (*this);
+	return angularDrifts_ [joint->rankInTree ()];
+      }
+      /// Get \f$\dot{J}_{com}\dot{q}\f$ for the center of mass
+      ///
+      /// Computed on first access after Device::computeForwardKinematics.
+      const vector3_t& driftCenterOfMass () const
+      {
+	if (!comDriftUpToDate_) device_->computeDriftCenterOfMass (*this);
+	return comDrift_;
+      }
+      /// \}
+
+      /// \name Collision statistics
+      /// \{
+
+      /// Number of pairs of objects tested by collision tests
+      ///
+      /// Counts the pairs tested by Device::collisionTest (const DeviceData&)
+      /// on this instance, and by Device::collisionTest () if this instance
+      /// is the data of the device (see Device::data), since the last call
+      /// to resetCollisionStatistics.
+      size_type numberCollisionPairs () const
+      {
+	return numberCollisionPairs_;
+      }
+      /// Number of pairs of objects rejected by bounding spheres
+      ///
+      /// Pairs counted by numberCollisionPairs the bounding spheres of which
+      /// are separated, for which fcl::collide is not called.
+      size_type numberCulledPairs () const
+      {
+	return numberCulledPairs_;
+      }
+      /// Reset collision statistics
+      void resetCollisionStatistics ()
+      {
+	numberCollisionPairs_ = numberCulledPairs_ = 0;
+      }
+      /// Enable or disable adaptive ordering of collision tests
+      ///
+      /// When enabled, Device::collisionTest (const DeviceData&) counts,
+      /// for each pair (inner object, outer object) of the bodies, the
+      /// number of collisions found with this instance and tests the pairs
+      /// by decreasing number of collisions, so that likely colliding pairs
+      /// are tested first. The test of an inner object against the
+      /// collision obstacles counts as one pair. Pairs with the same number
+      /// of collisions are tested in the default order: joint order, then
+      /// order of the lists of objects.
+      ///
+      /// Counts are stored in this instance: the order only depends on the
+      /// collision tests performed with it, and instances used by different
+      /// threads do not share any state. Counts are reset when the mode is
+      /// disabled and when the collision objects of the device change.
+      void adaptiveCollisionOrder (bool enable)
+      {
+	adaptiveCollisionOrder_ = enable;
+	collisionTests_.clear ();
+	collisionTestsVersion_ = -1;
+      }
+      /// Whether collision tests are ordered by number of collisions
+      bool adaptiveCollisionOrder () const
+      {
+	return adaptiveCollisionOrder_;
+      }
+      /// \}
+
+    protected:
+      DeviceData ();
+
+    private:
+      typedef std::vector <size_type> Ranks_t;
+      /// Rank of a joint in the kinematic tree of the device
+      /// \throw std::runtime_error if the joint does not belong to the
+      ///        kinematic tree.
+      size_type rankInTree (const JointConstPtr_t& joint) const;
+      /// Ranks in the kinematic tree of some joints and of their ancestors
+      /// in increasing order
+      const Ranks_t& path (const JointVector_t& joints);
+      /// Resize vectors to the kinematic chain of a device and mark all
+      /// joints as modified.
+      void init (const Device& device);
+      /// Mark all joints as modified
+      void invalidate ();
+      /// Count a collision found by the collision test of given position in
+      /// collisionTests_ and move the test before the tests with fewer
+      /// collisions.
+      void collisionFound (std::size_t position) const;
+
+      const Device* device_;
+      Configuration_t configuration_;
+      vector_t velocity_;
+      vector_t acceleration_;
+      /// Configuration at which quantities were last computed
+      Configuration_t computedConfiguration_;
+      Device::Computation_t computationFlag_;
+      bool upToDate_;
+      /// Whether each joint of the kinematic tree should be updated
+      std::vector <bool> modifiedJoints_;
+      /// Joint positions in the order of the kinematic tree
+      std::vector <Transform3f> positions_;
+      // Quantities below are computed on demand.
+      /// Joint Jacobians in the order of the kinematic tree
+      mutable std::vector <JointJacobian_t> jacobians_;
+      mutable std::vector <bool> jacobiansUpToDate_;
+      /// Joint Jacobians restricted to their support
+      mutable std::vector <SparseJacobian> sparseJacobians_;
+      mutable std::vector <bool> sparseJacobiansUpToDate_;
+      /// Workspace of size 6 x number of degrees of freedom of the
+      /// kinematic chain for joints of type JOINT_GENERIC
+      mutable JointJacobian_t jacobianWork_;
+      /// Mass times center of mass of each subtree
+      mutable std::vector <fcl::Vec3f> massCom_;
+      mutable vector3_t com_;
+      mutable bool comUpToDate_;
+      mutable ComJacobian_t jacobianCom_;
+      mutable bool jacobianComUpToDate_;
+      /// Joint velocities in the order of the kinematic tree
+      mutable std::vector <fcl::Vec3f> linearVelocities_;
+      mutable std::vector <fcl::Vec3f> angularVelocities_;
+      mutable bool velocitiesUpToDate_;
+      mutable vector3_t comVelocity_;
+      mutable bool comVelocityUpToDate_;
+      /// Joint accelerations in the order of the kinematic tree
+      mutable std::vector <fcl::Vec3f> linearAccelerations_;
+      mutable std::vector <fcl::Vec3f> angularAccelerations_;
+      mutable bool accelerationsUpToDate_;
+      mutable vector3_t comAcceleration_;
+      mutable bool comAccelerationUpToDate_;
+      /// Joint accelerations for a zero acceleration of the robot
+      mutable std::vector <fcl::Vec3f> linearDrifts_;
+      mutable std::vector <fcl::Vec3f> angularDrifts_;
+      mutable bool driftsUpToDate_;
+      mutable vector3_t comDrift_;
+      mutable bool comDriftUpToDate_;
+      /// Collision statistics
+      mutable size_type numberCollisionPairs_;
+      mutable size_type numberCulledPairs_;
+      /// Collision tests sorted by decreasing number of collisions, if
+      /// adaptive collision order is enabled
+      bool adaptiveCollisionOrder_;
+      mutable Device::CollisionTests_t collisionTests_;
+      /// Value of Device::collisionObjectsVersion_ when collisionTests_
+      /// was built
+      mutable size_type collisionTestsVersion_;
+      /// Paths computed by method path indexed by ranks of joints
+      std::map <Ranks_t, Ranks_t> paths_;
+      Ranks_t key_;
+      friend class Device;
+      friend class CenterOfMassComputation;
+      friend class Dynamics;
+      friend class ParallelCollisionTest;
+    }; // class DeviceData
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_DEVICE_DATA_HH
@@ -29,9 +29,14 @@
 # include <hpp/model/config.hh>
 # include <hpp/model/distance-result.hh>
 # include <hpp/model/extra-config-space.hh>
+# include <hpp/model/kinematic-tree.hh>
 # include <hpp/model/object-iterator.hh>
 # include <hpp/model/config.hh>
 
+namespace fcl {
+  class DynamicAABBTreeCollisionManager;
+} // namespace fcl
+
 namespace hpp {
   namespace model {
     /// \brief Robot with geometric and dynamic model
@@ -43,19 +48,29 @@ namespace hpp {
     /// http://www.boost.org/libs/smart_ptr/smart_ptr.htm
     class HPP_MODEL_DLLAPI Device
     {
+      friend class CollisionObject;
       friend class Body;
+      friend class DeviceData;
       friend class Joint;
+      friend class ParallelCollisionTest;
     public:
       /// Flags to select computation
       /// To optimize computation time, computations performed by method
       /// computeForwardKinematics can be selected by calling method
-      /// controlComputation.
+      /// controlComputation. Jacobians and center of mass that are not
+      /// selected are computed on first access after
+      /// computeForwardKinematics. If GEOMETRY is not selected, the fcl
+      /// objects attached to the joints are placed by the collision and
+      /// distance queries of the bodies when needed, or by updateGeometry.
+      /// Collision tests and distance computations of the device do not
+      /// need the fcl objects to be placed.
       enum Computation_t {
 	JOINT_POSITION = 0x0,
 	JACOBIAN = 0x1,
 	VELOCITY = 0x2,
 	ACCELERATION = 0x4,
 	COM = 0x8,
+	GEOMETRY = 0x10,
 	ALL = 0Xffff
       };
 
@@ -100,9 +115,35 @@ namespace hpp {
       /// Register joint in internal containers
       void registerJoint (const JointPtr_t& joint);
 
+      /// Start bulk construction of the kinematic chain and geometry
+      ///
+      /// Until the matching call to endBulkConstruction, adding joints,
+      /// bodies and objects to the device does not update the state
+      /// vectors, the mass, the number of distance results and the
+      /// kinematic tree of the device. Calls can be nested. Nothing should
+      /// be computed on the device during bulk construction.
+      void beginBulkConstruction ();
+      /// End bulk construction
+      ///
+      /// When the outermost bulk construction ends, update the quantities
+      /// that were not updated during bulk construction.
+      /// \throw std::runtime_error if bulk construction was not started.
+      void endBulkConstruction ();
+      /// Whether the device is under bulk construction
+      bool inBulkConstruction () const
+      {
+	return bulkConstruction_ > 0;
+      }
+
       /// Get vector of joints
       const JointVector_t& getJointVector () const;
 
+      /// Get kinematic chain compiled in depth-first order
+      const KinematicTree& kinematicTree () const
+      {
+	return kinematicTree_;
+      }
+
       /// Get joint by name
       /// \param name name of the joint.
       /// \throw runtime_error if device has no joint with this name
@@ -161,50 +202,33 @@ namespace hpp {
       /// \{
 
       /// Get current configuration
-      const Configuration_t& currentConfiguration () const
-      {
-	return currentConfiguration_;
-      }
+      const Configuration_t& currentConfiguration () const;
       /// Set current configuration
       /// \return True if the current configuration was modified and false if
       ///         the current configuration did not change.
-      virtual bool currentConfiguration (ConfigurationIn_t configuration)
-      {
-	if (configuration != currentConfiguration_) {
-	  upToDate_ = false;
-	  currentConfiguration_ = configuration;
-          return true;
-	}
-        return false;
-      }
+      ///
+      /// Joints the configuration of which changed are recorded, so that
+      /// the next call to computeForwardKinematics only updates the
+      /// subtrees rooted at these joints.
+      virtual bool currentConfiguration (ConfigurationIn_t configuration);
       /// Get the neutral configuration
       Configuration_t neutralConfiguration () const;
 
       /// Get current velocity
-      const vector_t& currentVelocity () const
-      {
-	return currentVelocity_;
-      }
+      const vector_t& currentVelocity () const;
 
       /// Set current velocity
-      void currentVelocity (vectorIn_t velocity)
-      {
-	upToDate_ = false;
-	currentVelocity_ = velocity;
-      }
+      ///
+      /// Joint velocities are computed from the current velocity on first
+      /// access, or by computeForwardKinematics if selected by
+      /// controlComputation.
+      void currentVelocity (vectorIn_t velocity);
 
       /// Get current acceleration
-      const vector_t& currentAcceleration () const
-      {
-	return currentAcceleration_;
-      }
+      const vector_t& currentAcceleration () const;
 
       /// Set current acceleration
-      void currentAcceleration (vectorIn_t acceleration)
-      {
-	upToDate_ = false;
-	currentAcceleration_ = acceleration;
-      }
+      void currentAcceleration (vectorIn_t acceleration);
       /// \}
 
       /// \name Mass and center of mass
@@ -216,15 +240,17 @@ namespace hpp {
 	return mass_;
       }
       /// Get position of center of mass
-      const vector3_t& positionCenterOfMass () const
-      {
-	return com_;
-      }
+      ///
+      /// Computed on first access after computeForwardKinematics.
+      const vector3_t& positionCenterOfMass () const;
       /// Get Jacobian of center of mass with respect to configuration
-      const ComJacobian_t& jacobianCenterOfMass () const
-      {
-	return jacobianCom_;
-      }
+      ///
+      /// Computed on first access after computeForwardKinematics.
+      const ComJacobian_t& jacobianCenterOfMass () const;
+      /// Get velocity of center of mass
+      ///
+      /// Computed on first access after computeForwardKinematics.
+      const vector3_t& velocityCenterOfMass () const;
 
       /// Add a gripper to the Device
       void addGripper (const GripperPtr_t& gripper)
@@ -249,8 +275,20 @@ namespace hpp {
 
       /// Get list of obstacles
       /// \param type collision or distance.
+      ///
+      /// Collision obstacles are the collision outer objects of the bodies
+      /// that are not attached to a joint (see Body::addOuterObject). They
+      /// are stored in a dynamic AABB tree so that collision tests only
+      /// call fcl::collide for obstacles close to the inner objects.
       const ObjectVector_t& obstacles (Request_t type) const;
 
+      /// Update obstacle tree after collision obstacles moved
+      ///
+      /// CollisionObject::move updates the tree of the devices holding the
+      /// object. This method should be called after the fcl objects of some
+      /// collision obstacles are moved directly.
+      void updateObstacles ();
+
       /// Add collision pairs between objects attached to two joints
       ///
       /// \param joint1 first joint
@@ -283,13 +321,51 @@ namespace hpp {
       /// \param type Collision or distance
       ObjectIterator objectIterator (Request_t type);
 
+      /// Place fcl objects attached to the joints
+      ///
+      /// Set the transform of the fcl objects stored as inner objects in
+      /// the bodies from the current joint positions. Only objects the
+      /// joint of which moved since last placement are updated, objects
+      /// used for both collision and distance are updated once.
+      ///
+      /// Called by computeForwardKinematics if GEOMETRY is selected by
+      /// controlComputation. Users accessing fcl objects directly should
+      /// call this method otherwise.
+      void updateGeometry () const;
+
       /// Test collision of current configuration
       /// \warning Users should call computeForwardKinematics first.
+      ///
+      /// Objects are tested at the joint positions stored in the data of
+      /// the device: fcl objects are not placed.
       bool collisionTest () const;
 
+      /// Test collision of the configuration stored in data
+      /// \param data result of computeForwardKinematics (DeviceData&).
+      ///
+      /// The positions of the collision objects attached to the joints of
+      /// the device are computed from data. The fcl objects are not
+      /// modified.
+      bool collisionTest (const DeviceData& data) const;
+
+      /// Enable or disable adaptive ordering of the collision tests
+      /// performed by collisionTest ()
+      /// \sa DeviceData::adaptiveCollisionOrder (bool)
+      void adaptiveCollisionOrder (bool enable);
+
       /// Compute distances between pairs of objects stored in bodies
+      ///
+      /// Only fcl objects involved in the computation are placed.
       void computeDistances ();
 
+      /// Compute distances between pairs of objects for the configuration
+      /// stored in data
+      /// \param data result of computeForwardKinematics (DeviceData&),
+      /// \retval results distances between pairs of objects in the same order
+      ///         as distanceResults (), resized if necessary.
+      void computeDistances (const DeviceData& data,
+			     DistanceResults_t& results) const;
+
       /// Get result of distance computations
       const DistanceResults_t&
 	distanceResults () const {return distances_;};
@@ -299,20 +375,52 @@ namespace hpp {
       /// \{
 
       /// Select computation
-      /// Optimize computation time by selecting only necessary values in
-      /// method computeForwardKinematics.
-      void controlComputation (const Computation_t& flag)
-      {
-	computationFlag_ = flag;
-	upToDate_ = false;
-      }
+      /// Select values computed by method computeForwardKinematics in
+      /// addition to joint positions. Other values are computed on first
+      /// access. By default, only joint positions are computed: the fcl
+      /// objects are not placed. Code reading the transforms of the fcl
+      /// objects (CollisionObject::fcl, CollisionObject::getTransform)
+      /// after forward kinematics should either select GEOMETRY or call
+      /// updateGeometry.
+      void controlComputation (const Computation_t& flag);
       /// Get computation flag
-      Computation_t computationFlag () const
-      {
-	return computationFlag_;
-      }
+      Computation_t computationFlag () const;
       /// Compute forward kinematics
       virtual void computeForwardKinematics ();
+      /// Compute forward kinematics of the configuration stored in data
+      ///
+      /// The device is not modified: this method can be called concurrently
+      /// by several threads, each with its own data.
+      void computeForwardKinematics (DeviceData& data) const;
+      /// Compute positions of some joints only
+      /// \param joints joints the positions of which are needed.
+      ///
+      /// Only the joints on the paths from the root joint to the given
+      /// joints, and the collision objects attached to them, are updated.
+      /// The Jacobians of the given joints are also computed if selected by
+      /// controlComputation.
+      /// \warning positions of other joints and center of mass are not
+      ///          valid until the next call to computeForwardKinematics ().
+      /// \throw std::runtime_error if a joint does not belong to the device.
+      void computeForwardKinematics (const JointVector_t& joints);
+      /// Compute positions of some joints for the configuration stored in data
+      /// \param joints joints the positions of which are needed.
+      ///
+      /// Only the joints on the paths from the root joint to the given
+      /// joints are updated. The paths are computed once for each set of
+      /// joints and stored in data. The Jacobians of the given joints are
+      /// also computed if selected by DeviceData::controlComputation.
+      /// \warning positions of other joints and center of mass are not
+      ///          valid until the next call to
+      ///          computeForwardKinematics (DeviceData&).
+      /// \throw std::runtime_error if a joint does not belong to the device.
+      void computeForwardKinematics (DeviceData& data,
+				     const JointVector_t& joints) const;
+      /// Get data storing the current state of the device
+      ///
+      /// Joint::currentTransformation and Joint::jacobian of the joints of
+      /// the device refer to this data.
+      const DeviceData& data () const;
       /// \}
 
       /// Print object in a stream
@@ -330,39 +438,133 @@ namespace hpp {
       /// Recompute number of distance pairs
       void updateDistances ();
 
+      /// Compile kinematic chain after a modification
+      void updateKinematicTree ();
+
     private:
-      void computeJointPositions ();
-      void computeJointJacobians ();
+      void computeForwardKinematics (DeviceData& data,
+				     bool updateJoints) const;
+      void computeForwardKinematics (DeviceData& data,
+				     const JointVector_t& joints,
+				     bool updateJoints) const;
+      void computeJointPositions (DeviceData& data, size_type begin,
+				  size_type end) const;
+      void computeJointJacobian (const DeviceData& data,
+				 size_type rank) const;
+      void computeSparseJointJacobian (const DeviceData& data,
+				       size_type rank) const;
+      void updateJoints (const DeviceData& data, size_type begin,
+			 size_type end) const;
+      /// Rank of a joint in the kinematic tree or -1 if the joint does not
+      /// belong to the device
+      size_type rankInTree (const JointPtr_t& joint) const;
+      /// Place inner objects of a joint for a type of request
+      void placeObjects (size_type rank, Request_t type) const;
+      /// Place the inner objects of the joint holding an object, if the
+      /// joint belongs to the device
+      void placeObjects (const CollisionObjectPtr_t& object,
+			 Request_t type) const;
       void computeMass ();
-      void computePositionCenterOfMass ();
-      void computeJacobianCenterOfMass ();
+      void computePositionCenterOfMass (const DeviceData& data) const;
+      void computeJacobianCenterOfMass (const DeviceData& data) const;
+      void computeVelocities (const DeviceData& data) const;
+      void computeVelocityCenterOfMass (const DeviceData& data) const;
+      void computeAccelerations (const DeviceData& data) const;
+      void computeDrifts (const DeviceData& data) const;
+      void computeAccelerationCenterOfMass (const DeviceData& data) const;
+      void computeDriftCenterOfMass (const DeviceData& data) const;
+      /// Compute acceleration of center of mass from joint accelerations
+      void computeAccelerationCenterOfMass
+      (const DeviceData& data, const std::vector <fcl::Vec3f>& linear,
+       const std::vector <fcl::Vec3f>& angular, vector3_t& result) const;
+      Transform3f objectPosition (const DeviceData& data,
+				  const CollisionObjectPtr_t& object) const;
+      /// Add a collision obstacle of a body to the obstacle tree
+      void addObstacle (const CollisionObjectPtr_t& object, const Body* body);
+      /// Update the obstacle tree after a collision obstacle moved
+      void obstacleMoved (const CollisionObjectPtr_t& object);
+      /// Remove a collision obstacle of a body from the obstacle tree
+      void removeObstacle (const CollisionObjectPtr_t& object,
+			   const Body* body);
+      /// Build a new obstacle tree from the collision obstacles of the
+      /// bodies
+      void rebuildObstacleTree ();
+      /// Test of an inner object of a body against an outer object of the
+      /// body, or against the collision obstacles of the body if outer is
+      /// empty.
+      struct CollisionTest_t {
+	JointPtr_t joint;
+	const Body* body;
+	CollisionObjectPtr_t inner;
+	CollisionObjectPtr_t outer;
+	/// Rank in the default order
+	std::size_t index;
+	/// Number of collisions found, for adaptive collision order
+	std::size_t hits;
+      }; // struct CollisionTest_t
+      typedef std::vector <CollisionTest_t> CollisionTests_t;
+      /// Notify that the collision objects of the bodies changed
+      void collisionObjectsModified ();
+      /// Build the list of collision tests in the default order
+      void computeCollisionTests (CollisionTests_t& tests) const;
+      /// Collision test in the order of the collision tests of data
+      bool adaptiveCollisionTest (const DeviceData& data) const;
+      /// Test collision of one pair for the configuration stored in data
+      /// \retval numberPairs, numberCulled incremented by the number of
+      ///         pairs of objects tested and rejected by bounding spheres.
+      bool collisionTest (const DeviceData& data, const CollisionTest_t& test,
+			  size_type& numberPairs,
+			  size_type& numberCulled) const;
+      /// Test collision of an object of a body against the obstacles of
+      /// the body stored in the obstacle tree
+      /// \param object inner object of the body,
+      /// \param position position of the object,
+      /// \param body the body,
+      /// \retval numberPairs, numberCulled incremented by the number of
+      ///         obstacles of the body and by the number of obstacles
+      ///         rejected by the tree.
+      bool collisionTestObstacles (const CollisionObjectPtr_t& object,
+				   const Transform3f& position,
+				   const Body* body, size_type& numberPairs,
+				   size_type& numberCulled) const;
       void resizeState (const JointPtr_t& joint);
-      void resizeJacobians ();
       std::string name_;
       DistanceResults_t distances_;
       JointByName_t jointByName_;
       JointVector_t jointVector_;
       JointPtr_t rootJoint_;
+      KinematicTree kinematicTree_;
       size_type numberDof_;
       size_type configSize_;
-      Configuration_t currentConfiguration_;
-      vector_t currentVelocity_;
-      vector_t currentAcceleration_;
-      vector3_t com_;
-      ComJacobian_t jacobianCom_;
+      /// Current configuration and quantities computed by forward
+      /// kinematics
+      DeviceDataPtr_t data_;
+      /// Whether the inner objects of each joint are placed, in the order
+      /// of the kinematic tree
+      mutable std::vector <bool> collisionPlaced_;
+      mutable std::vector <bool> distancePlaced_;
       value_type mass_;
-      bool upToDate_;
-      Computation_t computationFlag_;
       // Collision pairs between bodies
       CollisionPairs_t collisionPairs_;
       CollisionPairs_t distancePairs_;
       // Obstacles
       ObjectVector_t collisionObstacles_;
       ObjectVector_t distanceObstacles_;
+      typedef std::map <const fcl::CollisionObject*, std::vector <const Body*> >
+      ObstacleBodies_t;
+      /// Bodies for which each collision obstacle is an outer object
+      ObstacleBodies_t obstacleBodies_;
+      boost::shared_ptr <fcl::DynamicAABBTreeCollisionManager> obstacleTree_;
+      /// Incremented each time the collision objects of the bodies change
+      size_type collisionObjectsVersion_;
       // Grippers
       Grippers_t grippers_;
       // Extra configuration space
       ExtraConfigSpace extraConfigSpace_;
+      /// Depth of nested bulk constructions
+      size_type bulkConstruction_;
+      /// Number of joints when the outermost bulk construction started
+      std::size_t bulkFirstJoint_;
       DeviceWkPtr_t weakPtr_;
     }; // class Device
 
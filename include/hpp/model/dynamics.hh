@@ -0,0 +1,319 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#ifndef HPP_MODEL_DYNAMICS_HH
+# define HPP_MODEL_DYNAMICS_HH
+
+# include <vector>
+# include <Eigen/StdVector>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+
+namespace hpp {
+  namespace model {
+    /// Dynamics of the kinematic chain of a device
+    ///
+    /// Computations are performed on the bodies attached to the joints of
+    /// the kinematic tree of the device (see Device::kinematicTree) using
+    /// Body::mass, Body::localCenterOfMass and Body::inertiaMatrix, the
+    /// latter being the inertia about the center of mass expressed in the
+    /// joint frame.
+    ///
+    /// Each instance stores its own DeviceData and workspaces allocated
+    /// when the instance is created, so that computations do not allocate
+    /// memory and several instances can be used concurrently on the same
+    /// device.
+    ///
+    /// Velocities follow the conventions of the joint Jacobians: the
+    /// linear velocity of a joint is the velocity of its origin, linear and
+    /// angular velocities are expressed in world frame.
+    ///
+    /// The kinematic chain and the bodies of the device are read when the
+    /// instance is created. If masses or inertias are modified afterwards,
+    /// method readBodies should be called. If joints are added, a new
+    /// instance should be created.
+    class HPP_MODEL_DLLAPI Dynamics
+    {
+    public:
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+      /// Create an instance for a device
+      static DynamicsPtr_t create (const DeviceConstPtr_t& device);
+
+      /// Read masses, centers of mass and inertias of the bodies
+      void readBodies ();
+
+      /// Get data storing the kinematic quantities of the last computation
+      const DeviceData& data () const
+      {
+	return *data_;
+      }
+
+      /// \name Centroidal dynamics
+      /// \{
+
+      /// Compute centroidal momentum
+      /// \param configuration, velocity configuration and velocity of the
+      ///        robot.
+      ///
+      /// Compute the linear momentum and the angular momentum about the
+      /// center of mass, the centroidal momentum matrix and its bias term.
+      void computeCentroidalMomentum (ConfigurationIn_t configuration,
+				      vectorIn_t velocity);
+      /// Get centroidal momentum computed by computeCentroidalMomentum
+      ///
+      /// The first three coordinates store the linear momentum, the last
+      /// three the angular momentum about the center of mass.
+      const vector6_t& centroidalMomentum () const
+      {
+	return momentum_;
+      }
+      /// Get centroidal momentum matrix computed by computeCentroidalMomentum
+      ///
+      /// Matrix \f$A\f$ of size 6 x number of degrees of freedom of the
+      /// kinematic chain such that the centroidal momentum is \f$A\dot{q}\f$.
+      const matrix_t& centroidalMomentumMatrix () const
+      {
+	return momentumMatrix_;
+      }
+      /// Get bias term of the centroidal momentum computed by
+      /// computeCentroidalMomentum
+      ///
+      /// Term \f$\dot{A}\dot{q}\f$ so that the derivative of the centroidal
+      /// momentum is \f$A\ddot{q} + \dot{A}\dot{q}\f$.
+      const vector6_t& centroidalMomentumBias () const
+      {
+	return momentumBias_;
+      }
+      /// Compute acceleration of center of mass
+      /// \param acceleration acceleration of the robot.
+      ///
+      /// Uses the quantities computed by the last call to
+      /// computeCentroidalMomentum.
+      vector3_t accelerationCenterOfMass (vectorIn_t acceleration) const;
+      /// \}
+
+      /// \name Inverse dynamics
+      /// \{
+
+      /// Get gravity acceleration in world frame
+      const vector3_t& gravity () const
+      {
+	return gravity_;
+      }
+      /// Set gravity acceleration in world frame
+      ///
+      /// Default value is (0, 0, -9.81).
+      void gravity (const vector3_t& gravity)
+      {
+	gravity_ = gravity;
+      }
+      /// Compute joint torques by the recursive Newton-Euler algorithm
+      /// \param configuration, velocity, acceleration configuration,
+      ///        velocity and acceleration of the robot.
+      ///
+      /// Compute the generalized forces the joints should apply to move the
+      /// kinematic chain with the given acceleration under gravity.
+      /// The result is accessible by method torques.
+      void computeInverseDynamics (ConfigurationIn_t configuration,
+				   vectorIn_t velocity,
+				   vectorIn_t acceleration);
+      /// Compute joint torques compensating gravity
+      /// \param configuration configuration of the robot.
+      ///
+      /// Same result as computeInverseDynamics with zero velocity and
+      /// acceleration, without computing velocities, accelerations and
+      /// inertias of the bodies.
+      void computeGravityTorques (ConfigurationIn_t configuration);
+      /// Get joint torques computed by computeInverseDynamics or
+      /// computeGravityTorques
+      ///
+      /// Vector of size the number of degrees of freedom of the kinematic
+      /// chain in the order of the velocity vector.
+      const vector_t& torques () const
+      {
+	return torques_;
+      }
+      /// \}
+
+      /// \name Mass matrix
+      /// \{
+
+      /// Compute joint space mass matrix by the composite rigid body
+      /// algorithm
+      /// \param configuration configuration of the robot.
+      ///
+      /// Only entries of pairs of degrees of freedom on the same branch of
+      /// the kinematic tree are computed, other entries are zero.
+      void computeMassMatrix (ConfigurationIn_t configuration);
+      /// Get mass matrix computed by computeMassMatrix
+      ///
+      /// Symmetric matrix \f$M\f$ such that the kinetic energy of the robot
+      /// is \f$\frac{1}{2}\dot{q}^T M \dot{q}\f$.
+      const matrix_t& massMatrix () const
+      {
+	return massMatrix_;
+      }
+      /// Factorize mass matrix computed by computeMassMatrix
+      ///
+      /// Compute \f$M = L^T D L\f$ where \f$L\f$ is unit lower triangular
+      /// with the same sparsity as the lower part of \f$M\f$, so that no
+      /// fill-in occurs.
+      void factorizeMassMatrix ();
+      /// Solve linear system with mass matrix factorized by
+      /// factorizeMassMatrix
+      /// \param x right hand side columns, replaced by the solution of
+      ///        \f$M x = b\f$.
+      void solveMassMatrix (matrixOut_t x) const;
+      /// \}
+
+      /// \name Forward dynamics
+      /// \{
+
+      /// Compute joint accelerations by the articulated body algorithm
+      /// \param configuration, velocity configuration and velocity of the
+      ///        robot,
+      /// \param torques generalized forces applied by the joints.
+      ///
+      /// Compute the acceleration of the kinematic chain under gravity
+      /// without building the mass matrix. The result is accessible by
+      /// method acceleration.
+      void computeForwardDynamics (ConfigurationIn_t configuration,
+				   vectorIn_t velocity, vectorIn_t torques);
+      /// Get acceleration computed by computeForwardDynamics
+      const vector_t& acceleration () const
+      {
+	return acceleration_;
+      }
+      /// Simulate the robot during a time step
+      /// \param configuration, velocity state of the robot, replaced by the
+      ///        state at the end of the time step,
+      /// \param torques generalized forces applied by the joints during the
+      ///        time step,
+      /// \param timeStep duration of the time step.
+      ///
+      /// Semi-implicit Euler integration: the velocity is updated with the
+      /// acceleration computed by computeForwardDynamics, then the
+      /// configuration is integrated with the new velocity using
+      /// hpp::model::integrate.
+      void step (ConfigurationOut_t configuration, vectorOut_t velocity,
+		 vectorIn_t torques, value_type timeStep);
+      /// \}
+
+    protected:
+      Dynamics (const DeviceConstPtr_t& device);
+
+    private:
+      typedef Eigen::Matrix <value_type, 3, 1> Vector3_t;
+      typedef Eigen::Matrix <value_type, 3, 3> Matrix3_t;
+      typedef Eigen::Matrix <value_type, 6, 6> Matrix6_t;
+      typedef std::vector <vector6_t, Eigen::aligned_allocator <vector6_t> >
+      Vectors6_t;
+      typedef std::vector <Matrix6_t, Eigen::aligned_allocator <Matrix6_t> >
+      Matrices6_t;
+
+      /// Compute forward kinematics and position of the bodies
+      /// \param inertias whether to compute the inertias of the bodies in
+      ///        world frame.
+      void computeBodies (ConfigurationIn_t configuration, bool inertias);
+      /// Compute motion subspaces of the joints in motions_
+      void computeMotionSubspaces ();
+      /// Compute mass, mass times center of mass and inertia about the world
+      /// origin of each subtree
+      void computeCompositeInertias ();
+      /// Compute joint torques from forces_ and moments_ applied to the
+      /// bodies
+      void computeJointTorques ();
+      /// Compute momentum about world origin of a rigid body
+      /// \param mass, massCom, inertia mass, mass times center of mass and
+      ///        inertia about the world origin of the body,
+      /// \param linear, angular velocity of the world origin and angular
+      ///        velocity of the body,
+      /// \retval momentum linear momentum and angular momentum about the
+      ///         world origin.
+      static void momentum (value_type mass, const Vector3_t& massCom,
+			    const Matrix3_t& inertia, const Vector3_t& linear,
+			    const Vector3_t& angular, vector6_t& momentum);
+
+      DeviceConstPtr_t device_;
+      DeviceDataPtr_t data_;
+      size_type numberDof_;
+      // Bodies in the order of the kinematic tree
+      std::vector <value_type> masses_;
+      std::vector <Vector3_t> localComs_;
+      std::vector <Matrix3_t> localInertias_;
+      // Joint positions and bodies in world frame
+      std::vector <Matrix3_t> rotations_;
+      std::vector <Vector3_t> origins_;
+      std::vector <Vector3_t> coms_;
+      /// Inertia about the center of mass
+      std::vector <Matrix3_t> inertias_;
+      // Subtrees in world frame
+      std::vector <value_type> compositeMasses_;
+      std::vector <Vector3_t> compositeMassComs_;
+      /// Inertia about the world origin
+      std::vector <Matrix3_t> compositeInertias_;
+      /// Motion subspace of a joint
+      JointJacobian_t subspace_;
+      // Centroidal dynamics
+      vector6_t momentum_;
+      matrix_t momentumMatrix_;
+      vector6_t momentumBias_;
+      value_type totalMass_;
+      // Inverse dynamics
+      vector3_t gravity_;
+      /// Force and moment about the world origin applied to each body, then
+      /// to each subtree
+      std::vector <Vector3_t> forces_;
+      std::vector <Vector3_t> moments_;
+      vector_t torques_;
+      // Mass matrix
+      /// Motion subspaces as velocity of the world origin and angular
+      /// velocity
+      JointJacobian_t motions_;
+      matrix_t massMatrix_;
+      /// Factors L (strictly lower part) and D (diagonal)
+      matrix_t factor_;
+      /// Parent of each degree of freedom in the tree, -1 for the first
+      /// degree of freedom of the root
+      std::vector <size_type> dofParents_;
+      // Forward dynamics. Spatial vectors store the velocity of the world
+      // origin and angular velocity, or force and moment about the world
+      // origin.
+      /// Spatial acceleration of each body with respect to its parent for
+      /// a zero acceleration of the joint
+      Vectors6_t biases_;
+      Vectors6_t articulatedForces_;
+      Matrices6_t articulatedInertias_;
+      /// Articulated inertias times motion subspaces, left block of size
+      /// the number of degrees of freedom of the joint
+      Matrices6_t projectedInertias_;
+      /// Inverse of the articulated inertia of each joint projected on its
+      /// motion subspace, top left block of size the number of degrees of
+      /// freedom of the joint
+      Matrices6_t projectedInverses_;
+      vector_t projectedTorques_;
+      Vectors6_t spatialAccelerations_;
+      vector_t acceleration_;
+      Configuration_t configuration_;
+      vector_t velocityStep_;
+    }; // class Dynamics
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_DYNAMICS_HH
@@ -30,19 +30,27 @@
 
 namespace hpp {
   namespace model {
+    HPP_PREDEF_CLASS (BatchCollisionTest);
+    HPP_PREDEF_CLASS (ParallelCollisionTest);
+    HPP_PREDEF_CLASS (BatchForwardKinematics);
     HPP_PREDEF_CLASS (Body);
     HPP_PREDEF_CLASS (ChildrenIterator);
     HPP_PREDEF_CLASS (CollisionObject);
     HPP_PREDEF_CLASS (Device);
+    HPP_PREDEF_CLASS (DeviceData);
     HPP_PREDEF_CLASS (DistanceResult);
+    HPP_PREDEF_CLASS (Dynamics);
     HPP_PREDEF_CLASS (HumanoidRobot);
     HPP_PREDEF_CLASS (Joint);
     HPP_PREDEF_CLASS (JointAnchor);
     HPP_PREDEF_CLASS (JointRotation);
     HPP_PREDEF_CLASS (JointSO3);
     HPP_PREDEF_CLASS (JointConfiguration);
+    HPP_PREDEF_CLASS (KinematicTree);
+    HPP_PREDEF_CLASS (KinematicsGenerator);
     HPP_PREDEF_CLASS (ObjectFactory);
     HPP_PREDEF_CLASS (ObjectIterator);
+    HPP_PREDEF_CLASS (SparseJacobian);
     HPP_PREDEF_CLASS (Gripper);
     HPP_PREDEF_CLASS (CenterOfMassComputation);
     enum Request_t {COLLISION, DISTANCE};
@@ -56,22 +64,31 @@ namespace hpp {
     typedef Eigen::Ref <const vector_t> vectorIn_t;
     typedef Eigen::Ref <vector_t> vectorOut_t;
     typedef Eigen::Matrix<value_type, Eigen::Dynamic, Eigen::Dynamic> matrix_t;
+    typedef Eigen::Ref <const matrix_t> matrixIn_t;
     typedef Eigen::Ref <matrix_t> matrixOut_t;
     typedef matrix_t::Index size_type;
     typedef fcl::Matrix3f matrix3_t;
     typedef fcl::Vec3f vector3_t;
+    typedef Eigen::Matrix <value_type, 6, 1> vector6_t;
     typedef Eigen::Matrix <value_type, 6, Eigen::Dynamic> JointJacobian_t;
     typedef Eigen::Matrix <value_type, 3, Eigen::Dynamic> ComJacobian_t;
     typedef Eigen::Block <JointJacobian_t, 3, Eigen::Dynamic>
     HalfJointJacobian_t;
 
+    typedef boost::shared_ptr <BatchCollisionTest> BatchCollisionTestPtr_t;
+    typedef boost::shared_ptr <ParallelCollisionTest>
+      ParallelCollisionTestPtr_t;
+    typedef boost::shared_ptr <BatchForwardKinematics>
+      BatchForwardKinematicsPtr_t;
     typedef Body* BodyPtr_t;
     typedef std::vector<Body*> BodyVector_t;
     typedef boost::shared_ptr <CollisionObject> CollisionObjectPtr_t;
     typedef std::list <CollisionObjectPtr_t> ObjectVector_t;
     typedef boost::shared_ptr <Device> DevicePtr_t;
     typedef boost::shared_ptr <const Device> DeviceConstPtr_t;
+    typedef boost::shared_ptr <DeviceData> DeviceDataPtr_t;
     typedef std::vector <DistanceResult> DistanceResults_t;
+    typedef boost::shared_ptr <Dynamics> DynamicsPtr_t;
     typedef boost::shared_ptr <HumanoidRobot> HumanoidRobotPtr_t;
     typedef Joint* JointPtr_t;
     typedef JointAnchor* JointAnchorPtr_t;
@@ -88,6 +105,7 @@ namespace hpp {
     typedef const JointTranslation <1>* JointTranslationConstPtr_t;
     typedef const JointTranslation <2>* JointTranslation2ConstPtr_t;
     typedef const JointTranslation <3>* JointTranslation3ConstPtr_t;
+    typedef boost::shared_ptr <KinematicsGenerator> KinematicsGeneratorPtr_t;
     typedef std::map <std::string, JointPtr_t> JointByName_t;
     typedef std::vector <JointPtr_t> JointVector_t;
     typedef boost::shared_ptr <Gripper> GripperPtr_t;
@@ -132,6 +132,13 @@ namespace hpp {
       {
 	return rankInVelocity_;
       }
+      /// Return rank of the joint in the kinematic tree of the device
+      ///
+      /// \sa KinematicTree
+      size_type rankInTree () const
+      {
+	return rankInTree_;
+      }
 
       /// \name Kinematic chain
       /// \{
@@ -171,10 +178,7 @@ namespace hpp {
 	return positionInParentFrame_;
       }
       /// Set position of joint in parent frame
-      void positionInParentFrame (const Transform3f& p)
-      {
-	positionInParentFrame_ = p;
-      }
+      void positionInParentFrame (const Transform3f& p);
       ///\}
 
       /// \name Bounds
@@ -222,20 +226,39 @@ namespace hpp {
       /// \{
 
       /// Get const reference to Jacobian
-      const JointJacobian_t& jacobian () const
-      {
-	return jacobian_;
-      }
+      ///
+      /// If the joint belongs to a device, the Jacobian is stored in the
+      /// data of the device (see Device::data).
+      const JointJacobian_t& jacobian () const;
       /// Get non const reference to Jacobian
-      JointJacobian_t& jacobian ()
-      {
-	return jacobian_;
-      }
+      JointJacobian_t& jacobian ();
+      /// Write a block of Jacobian
+      ///
+      /// \param position position of this joint,
+      /// \param childPosition position of a joint the motion of which is
+      ///        generated by the degrees of freedom of this,
+      /// \retval jacobian Jacobian of the latter joint.
+      ///
+      /// The child joint should be a descendant of this.
+      /// This method writes in jacobian the motion generated by this at the
+      /// position of child. If index is the rank of this in the velocity
+      /// vector, the method fills colums from index to index + this joint
+      /// number of degrees of freedom.
+      ///
+      /// KinematicTree::computeJacobian gives the same result without
+      /// virtual calls for the joint types it knows.
+      virtual void writeSubJacobian (const Transform3f& position,
+				     const Transform3f& childPosition,
+				     JointJacobian_t& jacobian) const = 0;
       /// \}
       /// Access to configuration space
       JointConfiguration* configuration () const {return configuration_;}
       /// Set robot owning the kinematic chain
-      void robot (const DeviceWkPtr_t& device) {robot_ = device;}
+      void robot (const DeviceWkPtr_t& device)
+      {
+	robot_ = device;
+	device_ = device.lock ().get ();
+      }
       /// Access robot owning the object
       DeviceConstPtr_t robot () const { return robot_.lock ();}
       /// Access robot owning the object
@@ -290,7 +313,6 @@ namespace hpp {
       mutable Transform3f currentTransformation_;
       Transform3f positionInParentFrame_;
       Transform3f linkInJointFrame_;
-      mutable Transform3f T3f_;
       /// Mass of this and all descendants
       value_type mass_;
       /// Mass time center of mass of this and all descendants
@@ -298,22 +320,6 @@ namespace hpp {
       value_type maximalDistanceToParent_;
       vector_t neutralConfiguration_;
    private:
-      /// Compute position of this joint and all its descendents.
-      void recursiveComputePosition (ConfigurationIn_t configuration,
-				     const Transform3f& parentPosition) const;
-
-      /// Write a block of Jacobian
-      ///
-      /// child: joint the motion of which is generated by the degrees of
-      ///      freedom of this
-      ///
-      /// child should be a descendant of this.
-      /// This method writes in the jacobian of child the motion generated by
-      /// this at the current position of child. If index is the rank of this
-      /// in the velocity vector, the method fills colums from index to index +
-      /// this joint number of degrees of freedom.
-      virtual void writeSubJacobian (const JointPtr_t& child) = 0;
-      void computeJacobian ();
       /// Compute mass of this and all descendants
       value_type computeMass ();
       /// Compute the product m * com
@@ -321,12 +327,24 @@ namespace hpp {
       /// \li m is the mass of the joint and all descendants,
       /// \li com is the center of mass of the joint and all descendants.
       void computeMassTimesCenterOfMass ();
-      virtual void writeComSubjacobian (ComJacobian_t& jacobian,
-					const value_type& totalMass) = 0;
+      /// Write a block of the Jacobian of the center of mass
+      ///
+      /// \param position position of this joint,
+      /// \param massCom mass times center of mass of this joint and of all
+      ///        descendants,
+      /// \param totalMass mass of the device,
+      /// \retval jacobian Jacobian of the center of mass.
+      virtual void writeComSubjacobian (const Transform3f& position,
+					const fcl::Vec3f& massCom,
+					const value_type& totalMass,
+					ComJacobian_t& jacobian) const = 0;
       size_type configSize_;
       size_type numberDof_;
       Transform3f initialPosition_;
       DeviceWkPtr_t robot_;
+      /// Device owning the kinematic chain, cached to avoid locking robot_
+      /// in hot paths. Reset by the destructor of the device.
+      const Device* device_;
       BodyPtr_t body_;
       std::string name_;
       std::string linkName_;
@@ -334,12 +352,14 @@ namespace hpp {
       JointPtr_t parent_;
       size_type rankInConfiguration_;
       size_type rankInVelocity_;
+      size_type rankInTree_;
       JointJacobian_t jacobian_;
       /// Rank of the joint in vector of children of parent joint.
       std::size_t rankInParent_;
       friend class Device;
       friend class ChildrenIterator;
       friend class CenterOfMassComputation;
+      friend class KinematicTree;
     }; // class Joint
 
     /// Anchor Joint
@@ -379,9 +399,13 @@ namespace hpp {
     protected:
       virtual void computeMaximalDistanceToParent ();
     private:
-      virtual void writeSubJacobian (const JointPtr_t& child);
-      virtual void writeComSubjacobian (ComJacobian_t& jacobian,
-					const value_type& totalMass);
+      virtual void writeSubJacobian (const Transform3f& position,
+				     const Transform3f& childPosition,
+				     JointJacobian_t& jacobian) const;
+      virtual void writeComSubjacobian (const Transform3f& position,
+					const fcl::Vec3f& massCom,
+					const value_type& totalMass,
+					ComJacobian_t& jacobian) const;
     }; // class JointAnchor
 
     /// Spherical Joint
@@ -418,10 +442,13 @@ namespace hpp {
     protected:
       virtual void computeMaximalDistanceToParent ();
     private:
-      virtual void writeSubJacobian (const JointPtr_t& child);
-      virtual void writeComSubjacobian (ComJacobian_t& jacobian,
-					const value_type& totalMass);
-      mutable fcl::Vec3f com_;
+      virtual void writeSubJacobian (const Transform3f& position,
+				     const Transform3f& childPosition,
+				     JointJacobian_t& jacobian) const;
+      virtual void writeComSubjacobian (const Transform3f& position,
+					const fcl::Vec3f& massCom,
+					const value_type& totalMass,
+					ComJacobian_t& jacobian) const;
     }; // class JointSO3
 
     /// Rotation Joint
@@ -464,15 +491,14 @@ namespace hpp {
       }
     protected:
       virtual void computeMaximalDistanceToParent ();
-      mutable fcl::Matrix3f R_;
-      mutable fcl::Vec3f axis_;
-      mutable fcl::Vec3f O2O1_;
-      mutable fcl::Vec3f cross_;
-      mutable fcl::Vec3f com_;
     private:
-      virtual void writeSubJacobian (const JointPtr_t& child);
-      virtual void writeComSubjacobian (ComJacobian_t& jacobian,
-					const value_type& totalMass);
+      virtual void writeSubJacobian (const Transform3f& position,
+				     const Transform3f& childPosition,
+				     JointJacobian_t& jacobian) const;
+      virtual void writeComSubjacobian (const Transform3f& position,
+					const fcl::Vec3f& massCom,
+					const value_type& totalMass,
+					ComJacobian_t& jacobian) const;
     }; // class JointRotation
 
     namespace jointRotation {
@@ -499,9 +525,6 @@ namespace hpp {
 	virtual ~UnBounded ()
 	{
 	}
-      private:
-	mutable value_type cosAngle_;
-	mutable value_type sinAngle_;
       }; // class UnBounded
 
       /// Rotation about an axis with bound
@@ -525,8 +548,6 @@ namespace hpp {
 	virtual ~Bounded ()
 	{
 	}
-      private:
-	mutable value_type angle_;
       }; // class Bounded
     } // namespace jointRotation
     /// Translation Joint
@@ -564,12 +585,13 @@ namespace hpp {
     protected:
       virtual void computeMaximalDistanceToParent ();
     private:
-      virtual void writeSubJacobian (const JointPtr_t& child);
-      virtual void writeComSubjacobian (ComJacobian_t& jacobian,
-					const value_type& totalMass);
-      mutable fcl::Vec3f t_;
-      mutable fcl::Vec3f axis_ [dimension];
-      mutable fcl::Vec3f com_;
+      virtual void writeSubJacobian (const Transform3f& position,
+				     const Transform3f& childPosition,
+				     JointJacobian_t& jacobian) const;
+      virtual void writeComSubjacobian (const Transform3f& position,
+					const fcl::Vec3f& massCom,
+					const value_type& totalMass,
+					ComJacobian_t& jacobian) const;
     }; // class JointTranslation
 
     std::ostream& operator<< (std::ostream& os, const hpp::model::Joint& joint);
@@ -0,0 +1,246 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_MODEL_KINEMATIC_TREE_HH
+# define HPP_MODEL_KINEMATIC_TREE_HH
+
+# include <vector>
+# include <hpp/fcl/math/transform.h>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+
+namespace hpp {
+  namespace model {
+    /// Type of joint
+    ///
+    /// Used to dispatch computations on joints without virtual calls.
+    /// Joints of classes derived by users have type JOINT_GENERIC and are
+    /// handled through the virtual methods of Joint.
+    enum JointType_t {
+      JOINT_ANCHOR,
+      JOINT_SO3,
+      JOINT_ROTATION_BOUNDED,
+      JOINT_ROTATION_UNBOUNDED,
+      JOINT_TRANSLATION_1,
+      JOINT_TRANSLATION_2,
+      JOINT_TRANSLATION_3,
+      JOINT_GENERIC
+    };
+
+    /// Get type of a joint
+    JointType_t jointType (const JointConstPtr_t& joint);
+
+    /// Kinematic chain of a device compiled into a contiguous array
+    ///
+    /// Joints are stored in depth-first order, so that
+    /// \li the parent of a joint is stored before the joint,
+    /// \li the descendants of a joint are stored contiguously right after
+    ///     the joint.
+    ///
+    /// Each node stores the data necessary to compute the position of the
+    /// joint, so that forward kinematics is a single loop over the array
+    /// that does not dereference joints.
+    class HPP_MODEL_DLLAPI KinematicTree
+    {
+    public:
+      /// Node of the kinematic tree
+      struct Node_t {
+	/// Joint
+	JointPtr_t joint;
+	/// Type of the joint
+	JointType_t type;
+	/// Rank of parent joint in the tree, -1 for the root joint
+	size_type parent;
+	/// Rank in the tree following the last descendant of the joint
+	size_type subtreeEnd;
+	/// Rank of the joint in the configuration vector
+	size_type rankInConfiguration;
+	/// Rank of the joint in the velocity vector
+	size_type rankInVelocity;
+	/// Dimension of the joint configuration
+	size_type configSize;
+	/// Number of degrees of freedom of the joint
+	size_type numberDof;
+	/// Rotation of the joint in parent frame
+	fcl::Matrix3f rotationInParent;
+	/// Translation of the joint in parent frame
+	fcl::Vec3f translationInParent;
+      }; // struct Node_t
+      typedef std::vector <Node_t> Nodes_t;
+
+      /// Empty tree
+      KinematicTree ();
+
+      /// Compile the kinematic chain starting at a joint
+      ///
+      /// Set the rank of each joint in the tree (see Joint::rankInTree).
+      void compile (const JointPtr_t& rootJoint);
+
+      /// Number of joints
+      size_type size () const
+      {
+	return nodes_.size ();
+      }
+
+      /// Number of degrees of freedom of the joints
+      size_type numberDof () const
+      {
+	return numberDof_;
+      }
+
+      /// Get node of given rank
+      const Node_t& operator[] (size_type rank) const
+      {
+	return nodes_ [rank];
+      }
+
+      /// Get nodes
+      const Nodes_t& nodes () const
+      {
+	return nodes_;
+      }
+
+      /// Compute position of all joints
+      /// \param configuration the configuration of the robot,
+      /// \retval positions position of the joints in the order of the tree,
+      ///         resized if necessary.
+      void computePositions (ConfigurationIn_t configuration,
+			     std::vector <Transform3f>& positions) const;
+
+      /// Compute position of a range of joints
+      /// \param configuration the configuration of the robot,
+      /// \param begin, end range of ranks in the tree,
+      /// \retval positions position of the joints in the order of the tree.
+      ///
+      /// positions should be of size size (). The positions of the parents
+      /// of the joints in the range that do not belong to the range are
+      /// assumed to be up to date.
+      void computePositions (ConfigurationIn_t configuration,
+			     size_type begin, size_type end,
+			     std::vector <Transform3f>& positions) const;
+
+      /// Compute Jacobian of a joint
+      /// \param positions joint positions computed by computePositions,
+      /// \param rank rank of the joint in the tree,
+      /// \retval jacobian Jacobian of the joint of size 6 x number of
+      ///         degrees of freedom of the robot.
+      ///
+      /// Only the columns of the ancestors of the joint are written, other
+      /// columns are left unchanged. The result is identical to the
+      /// result of Joint::writeSubJacobian called on each ancestor.
+      void computeJacobian (const std::vector <Transform3f>& positions,
+			    size_type rank, JointJacobian_t& jacobian) const;
+
+      /// Compute Jacobian of a joint restricted to its support
+      /// \param positions joint positions computed by computePositions,
+      /// \param rank rank of the joint in the tree,
+      /// \retval jacobian non zero columns of the Jacobian of the joint,
+      /// \retval work matrix of size 6 x numberDof () in which
+      ///         Joint::writeSubJacobian writes the columns of ancestors of
+      ///         type JOINT_GENERIC.
+      void computeJacobian (const std::vector <Transform3f>& positions,
+			    size_type rank, SparseJacobian& jacobian,
+			    JointJacobian_t& work) const;
+
+      /// Compute motion subspace of a joint
+      /// \param positions joint positions computed by computePositions,
+      /// \param rank rank of the joint in the tree,
+      /// \retval subspace matrix of at least numberDof columns of the
+      ///         joint, the first of which store the linear velocity of the
+      ///         joint origin and the angular velocity of the joint in world
+      ///         frame induced by each degree of freedom of the joint,
+      /// \retval work matrix of size 6 x numberDof () used if the joint is
+      ///         of type JOINT_GENERIC.
+      void motionSubspace (const std::vector <Transform3f>& positions,
+			   size_type rank, JointJacobian_t& subspace,
+			   JointJacobian_t& work) const;
+
+      /// Compute velocity of all joints
+      /// \param positions joint positions computed by computePositions,
+      /// \param velocity velocity of the robot,
+      /// \retval linear, angular linear and angular velocities of the
+      ///         joint origins in world frame, in the order of the tree,
+      ///         resized if necessary,
+      /// \retval work matrix of size 6 x numberDof () used for joints of
+      ///         type JOINT_GENERIC.
+      ///
+      /// Velocities are propagated from the root joint to the leaves, so
+      /// that no Jacobian is computed.
+      void computeVelocities (const std::vector <Transform3f>& positions,
+			      vectorIn_t velocity,
+			      std::vector <fcl::Vec3f>& linear,
+			      std::vector <fcl::Vec3f>& angular,
+			      JointJacobian_t& work) const;
+
+      /// Compute acceleration of all joints
+      /// \param positions joint positions computed by computePositions,
+      /// \param velocity velocity of the robot,
+      /// \param acceleration acceleration of the robot. If empty, the
+      ///        acceleration is assumed to be zero, which gives the terms
+      ///        \f$\dot{J}\dot{q}\f$ of the joint Jacobians,
+      /// \param linearVelocities, angularVelocities joint velocities
+      ///        computed by computeVelocities,
+      /// \retval linear, angular linear acceleration of the joint origins
+      ///         and angular acceleration of the joints in world frame, in
+      ///         the order of the tree, resized if necessary,
+      /// \retval work matrix of size 6 x numberDof () used for joints of
+      ///         type JOINT_GENERIC.
+      ///
+      /// The motion subspace of joints of type JOINT_GENERIC is assumed to
+      /// be fixed in the frame of the parent joint.
+      void computeAccelerations
+      (const std::vector <Transform3f>& positions, vectorIn_t velocity,
+       vectorIn_t acceleration,
+       const std::vector <fcl::Vec3f>& linearVelocities,
+       const std::vector <fcl::Vec3f>& angularVelocities,
+       std::vector <fcl::Vec3f>& linear,
+       std::vector <fcl::Vec3f>& angular, JointJacobian_t& work) const;
+
+      /// Write the columns of a joint in the Jacobian of a center of mass
+      /// \param node node of the joint,
+      /// \param position position of the joint,
+      /// \param massCom mass times center of mass of the subtree rooted at
+      ///        the joint,
+      /// \param mass mass of the subtree,
+      /// \param totalMass mass of the set of bodies the center of mass of
+      ///        which is computed,
+      /// \retval jacobian Jacobian of the center of mass.
+      ///
+      /// Same result as Joint::writeComSubjacobian.
+      static void writeComColumns (const Node_t& node,
+				   const Transform3f& position,
+				   const fcl::Vec3f& massCom, value_type mass,
+				   value_type totalMass,
+				   ComJacobian_t& jacobian);
+
+    private:
+      /// Write the columns of the degrees of freedom of a joint, starting
+      /// at column col, in the Jacobian of a descendant at position
+      /// childPosition. Joints of type JOINT_GENERIC write their columns in
+      /// work if col is not their rank in the velocity vector.
+      static void writeColumns (const Node_t& node,
+				const Transform3f& position,
+				const Transform3f& childPosition,
+				JointJacobian_t& jacobian, size_type col,
+				JointJacobian_t& work);
+      Nodes_t nodes_;
+      size_type numberDof_;
+    }; // class KinematicTree
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_KINEMATIC_TREE_HH
@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_MODEL_KINEMATICS_GENERATOR_HH
+# define HPP_MODEL_KINEMATICS_GENERATOR_HH
+
+# include <iosfwd>
+# include <string>
+# include <vector>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+# include <hpp/model/kinematic-tree.hh>
+
+namespace hpp {
+  namespace model {
+    /// Generate C++ code computing the kinematics of a device
+    ///
+    /// The generated header defines a class template, parameterized by the
+    /// scalar type, with static methods computing forward kinematics, joint
+    /// Jacobians and center of mass of the device. The kinematic chain is
+    /// unrolled: there is no loop over joints and no virtual call, and the
+    /// constant positions of joints in their parent frames, as well as the
+    /// masses of the bodies, are folded into the expressions.
+    ///
+    /// The generated header only depends on the standard library. It
+    /// defines class \c className in namespace \c namespaceName with the
+    /// following members:
+    /// \li enum values \c configSize, \c numberDof and \c numberJoints,
+    /// \li <tt>forwardKinematics (const Scalar* q, Scalar* M)</tt>
+    ///     computes the positions of the joints, stored as in
+    ///     BatchForwardKinematics::PlacementBatch_t for a single
+    ///     configuration: 12 values per joint in the order of the kinematic
+    ///     tree (rotation matrix in row-major order, then translation),
+    /// \li <tt>jacobians (const Scalar* M, Scalar* J)</tt> computes the
+    ///     Jacobians of the joints: a column-major 6 x \c numberDof matrix
+    ///     per joint in the order of the kinematic tree,
+    /// \li <tt>massCenters (const Scalar* M, Scalar* mc)</tt> computes
+    ///     mass times center of mass of the subtree of each joint: 3 values
+    ///     per joint in the order of the kinematic tree,
+    /// \li <tt>centerOfMass (const Scalar* M, Scalar* com)</tt> computes
+    ///     the position of the center of mass,
+    /// \li <tt>jacobianCenterOfMass (const Scalar* M, Scalar* J)</tt>
+    ///     computes the column-major 3 x \c numberDof Jacobian of the
+    ///     center of mass.
+    ///
+    /// \c numberDof excludes the extra configuration space. Methods taking
+    /// joint positions expect the output of \c forwardKinematics.
+    ///
+    /// Constants within a few ulps of 0, 1 or -1 are replaced by these
+    /// values, so that rounding errors in joint positions do not prevent
+    /// folding. Results may thus differ slightly from Device.
+    class HPP_MODEL_DLLAPI KinematicsGenerator
+    {
+    public:
+      /// Create a generator for a device
+      ///
+      /// The kinematic chain and the bodies of the device are read when the
+      /// code is generated.
+      static KinematicsGeneratorPtr_t create (const DeviceConstPtr_t& device);
+
+      /// Set name of generated class
+      void className (const std::string& name)
+      {
+	className_ = name;
+      }
+      /// Get name of generated class
+      const std::string& className () const
+      {
+	return className_;
+      }
+      /// Set namespace of generated class
+      void namespaceName (const std::string& name)
+      {
+	namespaceName_ = name;
+      }
+      /// Get namespace of generated class
+      const std::string& namespaceName () const
+      {
+	return namespaceName_;
+      }
+
+      /// Write header
+      /// \throw std::runtime_error if the device contains joints of type
+      ///        JOINT_GENERIC.
+      void generate (std::ostream& os) const;
+
+    protected:
+      KinematicsGenerator (const DeviceConstPtr_t& device);
+
+    private:
+      void writeForwardKinematics (std::ostream& os) const;
+      void writeJacobians (std::ostream& os) const;
+      void writeMassCenters (std::ostream& os,
+			     const std::vector <value_type>& masses) const;
+      void writeCenterOfMass (std::ostream& os,
+			      const std::vector <value_type>& masses) const;
+      void writeJacobianCenterOfMass
+      (std::ostream& os, const std::vector <value_type>& masses) const;
+      DeviceConstPtr_t device_;
+      std::string className_;
+      std::string namespaceName_;
+    }; // class KinematicsGenerator
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_KINEMATICS_GENERATOR_HH
@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#ifndef HPP_MODEL_PARALLEL_COLLISION_TEST_HH
+# define HPP_MODEL_PARALLEL_COLLISION_TEST_HH
+
+# include <boost/atomic.hpp>
+# include <boost/thread/condition_variable.hpp>
+# include <boost/thread/mutex.hpp>
+# include <boost/thread/thread.hpp>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+# include <hpp/model/device.hh>
+
+namespace hpp {
+  namespace model {
+    /// Collision test of a configuration on several threads
+    ///
+    /// The pairs tested by Device::collisionTest (const DeviceData&), each
+    /// inner object of a body against each outer object of the body, are
+    /// distributed one by one to a pool of threads created with the
+    /// instance. As soon as a thread finds a collision, the other threads
+    /// stop after their current pair. The result is the same as the result
+    /// of Device::collisionTest (const DeviceData&).
+    ///
+    /// The pairs are read again from the device when its collision objects
+    /// change. The adaptive collision order of the data (see
+    /// DeviceData::adaptiveCollisionOrder) is not used.
+    ///
+    /// \note An instance should be used by one thread at a time.
+    class HPP_MODEL_DLLAPI ParallelCollisionTest
+    {
+    public:
+      /// Create an instance for a device
+      /// \param numberThreads number of threads testing pairs, including
+      ///        the thread calling compute. If 0, the number of hardware
+      ///        threads is used.
+      static ParallelCollisionTestPtr_t create (const DeviceConstPtr_t& device,
+						size_type numberThreads = 0);
+
+      /// Stop and join the threads
+      ~ParallelCollisionTest ();
+
+      /// Test collision of the configuration stored in data
+      /// \param data result of Device::computeForwardKinematics (DeviceData&).
+      ///
+      /// The pairs tested and rejected by bounding spheres are added to the
+      /// collision statistics of data (see DeviceData::numberCollisionPairs).
+      bool compute (const DeviceData& data);
+
+      /// Number of threads testing pairs, including the thread calling
+      /// compute
+      size_type numberThreads () const
+      {
+	return threads_.size () + 1;
+      }
+
+    protected:
+      ParallelCollisionTest (const DeviceConstPtr_t& device,
+			     size_type numberThreads);
+
+    private:
+      /// Loop of the threads of the pool
+      void work ();
+      /// Test pairs until all pairs are tested or a collision is found
+      void testPairs (size_type& numberPairs, size_type& numberCulled);
+
+      DeviceConstPtr_t device_;
+      /// Pairs in the order of Device::collisionTest
+      Device::CollisionTests_t tests_;
+      /// Value of Device::collisionObjectsVersion_ when tests_ was built
+      size_type testsVersion_;
+      std::vector <boost::thread*> threads_;
+      boost::mutex mutex_;
+      /// Notified when a test starts or threads should stop
+      boost::condition_variable start_;
+      /// Notified when the last thread of the pool is done
+      boost::condition_variable done_;
+      // Members below are protected by mutex_.
+      /// Data of the current test
+      const DeviceData* data_;
+      /// Incremented at each test
+      std::size_t generation_;
+      /// Number of threads of the pool testing pairs
+      std::size_t running_;
+      bool stop_;
+      size_type numberPairs_;
+      size_type numberCulled_;
+      // Members below are shared without lock during a test.
+      /// Index of the next pair to test
+      boost::atomic <std::size_t> next_;
+      /// Whether a collision was found by a thread
+      boost::atomic <bool> collision_;
+    }; // class ParallelCollisionTest
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_PARALLEL_COLLISION_TEST_HH
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#ifndef HPP_MODEL_SPARSE_JACOBIAN_HH
+# define HPP_MODEL_SPARSE_JACOBIAN_HH
+
+# include <vector>
+# include <hpp/model/config.hh>
+# include <hpp/model/fwd.hh>
+
+namespace hpp {
+  namespace model {
+    /// Jacobian of a joint restricted to its support
+    ///
+    /// Only the degrees of freedom of the ancestors of a joint move the
+    /// joint. This class stores the columns of the Jacobian corresponding
+    /// to these degrees of freedom together with their indices in the
+    /// velocity vector, other columns being zero.
+    ///
+    /// Instances are filled by KinematicTree::computeJacobian or accessed
+    /// through DeviceData::sparseJacobian.
+    class HPP_MODEL_DLLAPI SparseJacobian
+    {
+    public:
+      typedef std::vector <size_type> Indices_t;
+
+      /// Empty Jacobian
+      SparseJacobian ();
+
+      /// Number of columns of the dense Jacobian
+      size_type numberDof () const
+      {
+	return numberDof_;
+      }
+      /// Indices of the non zero columns in the velocity vector
+      ///
+      /// Columns are ordered from the root joint to the joint.
+      const Indices_t& indices () const
+      {
+	return indices_;
+      }
+      /// Non zero columns
+      ///
+      /// Column i corresponds to column indices () [i] of the dense Jacobian.
+      const JointJacobian_t& values () const
+      {
+	return values_;
+      }
+
+      /// Compute product by a velocity vector
+      /// \param velocity vector of size numberDof,
+      /// \retval result linear and angular velocity of the joint.
+      void multiply (vectorIn_t velocity, vector6_t& result) const;
+      /// Compute product of the transpose by a wrench
+      /// \param wrench vector of size 6,
+      /// \retval result vector of size numberDof. Entries out of the support
+      ///         of the Jacobian are set to 0.
+      void transposeMultiply (const vector6_t& wrench, vectorOut_t result)
+	const;
+      /// Write the dense Jacobian
+      /// \retval jacobian matrix resized to 6 x numberDof if necessary.
+      void toDense (JointJacobian_t& jacobian) const;
+
+    private:
+      size_type numberDof_;
+      Indices_t indices_;
+      JointJacobian_t values_;
+      friend class KinematicTree;
+    }; // class SparseJacobian
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_SPARSE_JACOBIAN_HH
@@ -0,0 +1,105 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include <hpp/model/batch-collision-test.hh>
+#include <hpp/fcl/collision_object.h>
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/device-data.hh>
+#include <hpp/model/joint.hh>
+
+namespace hpp {
+  namespace model {
+    BatchCollisionTestPtr_t BatchCollisionTest::create
+    (const DeviceConstPtr_t& device)
+    {
+      return BatchCollisionTestPtr_t (new BatchCollisionTest (device));
+    }
+
+    BatchCollisionTest::BatchCollisionTest (const DeviceConstPtr_t& device) :
+      device_ (device),
+      forwardKinematics_ (BatchForwardKinematics::create (device)),
+      data_ (DeviceData::create (device)), pairs_ (), margin_ (1e-4),
+      numberConfirmed_ (0)
+    {
+      const KinematicTree& tree (device->kinematicTree ());
+      for (size_type i = 0; i < tree.size (); ++i) {
+	BodyPtr_t body = tree [i].joint->linkedBody ();
+	if (!body || body->innerObjects (COLLISION).empty ()) continue;
+	const ObjectVector_t& outer = body->outerObjects (COLLISION);
+	for (ObjectVector_t::const_iterator it = outer.begin ();
+	     it != outer.end (); ++it) {
+	  Pair_t pair;
+	  pair.rank = i;
+	  pair.outerRank = -1;
+	  const JointPtr_t& joint ((*it)->joint ());
+	  if (joint && joint->rankInTree () >= 0 &&
+	      joint->rankInTree () < tree.size () &&
+	      tree [joint->rankInTree ()].joint == joint) {
+	    pair.outerRank = joint->rankInTree ();
+	    pair.radius = body->radius () + joint->linkedBody ()->radius ();
+	  } else {
+	    fcl::CollisionGeometryConstPtr_t geometry
+	      ((*it)->fcl ()->collisionGeometry ());
+	    pair.center = (*it)->getTransform ().transform
+	      (geometry->aabb_center);
+	    pair.radius = body->radius () + geometry->aabb_radius;
+	  }
+	  pairs_.push_back (pair);
+	}
+      }
+    }
+
+    void BatchCollisionTest::compute (matrixIn_t configurations,
+				      std::vector <bool>& collisions)
+    {
+      const size_type N = configurations.rows ();
+      forwardKinematics_->compute (configurations, placements_);
+      near_.setConstant (N, false);
+      for (Pairs_t::const_iterator it = pairs_.begin (); it != pairs_.end ();
+	   ++it) {
+	const size_type r = 12*it->rank + 9;
+	const size_type o = 12*it->outerRank + 9;
+	squaredDistance_.setZero (N);
+	for (size_type k = 0; k < 3; ++k) {
+	  if (it->outerRank >= 0) {
+	    squaredDistance_ += (placements_.row (r+k).array () -
+				 placements_.row (o+k).array ()).square ();
+	  } else {
+	    squaredDistance_ += (placements_.row (r+k).array () -
+				 (float) it->center [k]).square ();
+	  }
+	}
+	const float threshold = (float) (it->radius + margin_);
+	near_ = near_ || (squaredDistance_ <= threshold * threshold);
+      }
+      // Confirm configurations with close spheres in double precision.
+      collisions.assign (N, false);
+      numberConfirmed_ = 0;
+      for (size_type n = 0; n < N; ++n) {
+	if (!near_ [n]) continue;
+	++numberConfirmed_;
+	data_->currentConfiguration (configurations.row (n).transpose ());
+	device_->computeForwardKinematics (*data_);
+	collisions [n] = device_->collisionTest (*data_);
+      }
+    }
+  } // namespace model
+} // namespace hpp
@@ -0,0 +1,256 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <hpp/model/batch-forward-kinematics.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+
+namespace hpp {
+  namespace model {
+    BatchForwardKinematicsPtr_t BatchForwardKinematics::create
+    (const DeviceConstPtr_t& device)
+    {
+      return BatchForwardKinematicsPtr_t (new BatchForwardKinematics (device));
+    }
+
+    BatchForwardKinematics::BatchForwardKinematics
+    (const DeviceConstPtr_t& device) : tree_ (device->kinematicTree ()),
+				       configSize_ (device->configSize ()),
+				       work_ (21, 0)
+    {
+    }
+
+    size_type BatchForwardKinematics::rank (const JointConstPtr_t& joint) const
+    {
+      size_type rank = joint->rankInTree ();
+      if (rank < 0 || rank >= tree_.size () || tree_ [rank].joint != joint) {
+	throw std::runtime_error ("Joint " + joint->name () +
+				  " does not belong to the device.");
+      }
+      return rank;
+    }
+
+    namespace {
+      template <typename Batch>
+      Transform3f placement (const Batch& placements, size_type rank,
+			     size_type index)
+      {
+	const size_type r = 12*rank;
+	fcl::Matrix3f R (placements (r+0, index), placements (r+1, index),
+			 placements (r+2, index), placements (r+3, index),
+			 placements (r+4, index), placements (r+5, index),
+			 placements (r+6, index), placements (r+7, index),
+			 placements (r+8, index));
+	fcl::Vec3f T (placements (r+9, index), placements (r+10, index),
+		      placements (r+11, index));
+	return Transform3f (R, T);
+      }
+    } // namespace
+
+    Transform3f BatchForwardKinematics::placement
+    (const PlacementBatch_t& placements, size_type rank, size_type index)
+    {
+      return model::placement (placements, rank, index);
+    }
+
+    Transform3f BatchForwardKinematics::placement
+    (const PlacementBatchf_t& placements, size_type rank, size_type index)
+    {
+      return model::placement (placements, rank, index);
+    }
+
+    template <typename Batch>
+    void BatchForwardKinematics::computeParentProduct
+    (const KinematicTree::Node_t& node, const Batch& placements,
+     Batch& work) const
+    {
+      typedef typename Batch::Scalar Scalar;
+      // work [0:12] = parent position * position in parent frame
+      const fcl::Matrix3f& R (node.rotationInParent);
+      const fcl::Vec3f& T (node.translationInParent);
+      if (node.parent < 0) {
+	for (size_type r = 0; r < 3; ++r) {
+	  for (size_type c = 0; c < 3; ++c) {
+	    work.row (3*r+c).setConstant ((Scalar) R (r, c));
+	  }
+	  work.row (9+r).setConstant ((Scalar) T [r]);
+	}
+	return;
+      }
+      const size_type p = 12*node.parent;
+      for (size_type r = 0; r < 3; ++r) {
+	for (size_type c = 0; c < 3; ++c) {
+	  work.row (3*r+c) =
+	    (Scalar) R (0, c) * placements.row (p+3*r+0) +
+	    (Scalar) R (1, c) * placements.row (p+3*r+1) +
+	    (Scalar) R (2, c) * placements.row (p+3*r+2);
+	}
+	work.row (9+r) = placements.row (p+9+r) +
+	  (Scalar) T [0] * placements.row (p+3*r+0) +
+	  (Scalar) T [1] * placements.row (p+3*r+1) +
+	  (Scalar) T [2] * placements.row (p+3*r+2);
+      }
+    }
+
+    template <typename Batch>
+    void BatchForwardKinematics::computeGeneric
+    (size_type i, matrixIn_t configurations, Batch& placements) const
+    {
+      const KinematicTree::Node_t& node (tree_ [i]);
+      Transform3f parentPosition, position;
+      parentPosition.setIdentity ();
+      vector_t q (configurations.cols ());
+      for (size_type n = 0; n < configurations.rows (); ++n) {
+	if (node.parent >= 0) {
+	  parentPosition = model::placement (placements, node.parent, n);
+	}
+	q = configurations.row (n).transpose ();
+	node.joint->computePosition (q, parentPosition, position);
+	const fcl::Matrix3f& R (position.getRotation ());
+	const fcl::Vec3f& T (position.getTranslation ());
+	for (size_type r = 0; r < 3; ++r) {
+	  for (size_type c = 0; c < 3; ++c) {
+	    placements (12*i+3*r+c, n) = R (r, c);
+	  }
+	  placements (12*i+9+r, n) = T [r];
+	}
+      }
+    }
+
+    void BatchForwardKinematics::compute (matrixIn_t configurations,
+					  PlacementBatch_t& placements)
+    {
+      if (configurations.cols () != configSize_) {
+	throw std::runtime_error ("Configurations should be stored as rows of "
+				  "a matrix with as many columns as the "
+				  "configuration size of the device.");
+      }
+      const size_type N = configurations.rows ();
+      placements.resize (12*tree_.size (), N);
+      work_.resize (21, N);
+      computeBatch (configurations, configurations, placements, work_);
+    }
+
+    void BatchForwardKinematics::compute (matrixIn_t configurations,
+					  PlacementBatchf_t& placements)
+    {
+      if (configurations.cols () != configSize_) {
+	throw std::runtime_error ("Configurations should be stored as rows of "
+				  "a matrix with as many columns as the "
+				  "configuration size of the device.");
+      }
+      const size_type N = configurations.rows ();
+      placements.resize (12*tree_.size (), N);
+      workf_.resize (21, N);
+      configurationsf_ = configurations.cast <float> ();
+      computeBatch (configurations, configurationsf_, placements, workf_);
+    }
+
+    template <typename Configurations, typename Batch>
+    void BatchForwardKinematics::computeBatch
+    (matrixIn_t genericConfigurations, const Configurations& configurations,
+     Batch& placements, Batch& work) const
+    {
+      typedef typename Batch::Scalar Scalar;
+      for (size_type i = 0; i < tree_.size (); ++i) {
+	const KinematicTree::Node_t& node (tree_ [i]);
+	if (node.type == JOINT_GENERIC) {
+	  computeGeneric (i, genericConfigurations, placements);
+	  continue;
+	}
+	computeParentProduct (node, placements, work);
+	typename Batch::RowsBlockXpr out (placements.middleRows (12*i, 12));
+	const size_type rank = node.rankInConfiguration;
+	switch (node.type) {
+	case JOINT_ANCHOR:
+	  out = work.topRows (12);
+	  break;
+	case JOINT_ROTATION_BOUNDED:
+	case JOINT_ROTATION_UNBOUNDED:
+	  // Rotation about x-axis: rows 12 and 13 store cos and sin.
+	  if (node.type == JOINT_ROTATION_BOUNDED) {
+	    work.row (12) = configurations.col (rank).transpose ().array ().
+	      cos ().matrix ();
+	    work.row (13) = configurations.col (rank).transpose ().array ().
+	      sin ().matrix ();
+	  } else {
+	    work.row (12) = configurations.col (rank).transpose ();
+	    work.row (13) = configurations.col (rank+1).transpose ();
+	  }
+	  for (size_type r = 0; r < 3; ++r) {
+	    out.row (3*r) = work.row (3*r);
+	    out.row (3*r+1) = (work.row (3*r+1).array () *
+			       work.row (12).array () +
+			       work.row (3*r+2).array () *
+			       work.row (13).array ()).matrix ();
+	    out.row (3*r+2) = (work.row (3*r+2).array () *
+			       work.row (12).array () -
+			       work.row (3*r+1).array () *
+			       work.row (13).array ()).matrix ();
+	    out.row (9+r) = work.row (9+r);
+	  }
+	  break;
+	case JOINT_TRANSLATION_1:
+	case JOINT_TRANSLATION_2:
+	case JOINT_TRANSLATION_3:
+	  out.topRows (9) = work.topRows (9);
+	  for (size_type r = 0; r < 3; ++r) {
+	    out.row (9+r) = work.row (9+r);
+	    for (size_type k = 0; k < node.configSize; ++k) {
+	      out.row (9+r).array () += work.row (3*r+k).array () *
+		configurations.col (rank+k).transpose ().array ();
+	    }
+	  }
+	  break;
+	case JOINT_SO3:
+	  {
+	    // Rotation matrix of quaternion (w, x, y, z) in rows 12 to 20.
+	    typedef Eigen::Array <Scalar, 1, Eigen::Dynamic> Row_t;
+	    const Row_t w (configurations.col (rank).transpose ());
+	    const Row_t x (configurations.col (rank+1).transpose ());
+	    const Row_t y (configurations.col (rank+2).transpose ());
+	    const Row_t z (configurations.col (rank+3).transpose ());
+	    work.row (12) = (1 - 2*(y*y + z*z)).matrix ();
+	    work.row (13) = (2*(x*y - z*w)).matrix ();
+	    work.row (14) = (2*(x*z + y*w)).matrix ();
+	    work.row (15) = (2*(x*y + z*w)).matrix ();
+	    work.row (16) = (1 - 2*(x*x + z*z)).matrix ();
+	    work.row (17) = (2*(y*z - x*w)).matrix ();
+	    work.row (18) = (2*(x*z - y*w)).matrix ();
+	    work.row (19) = (2*(y*z + x*w)).matrix ();
+	    work.row (20) = (1 - 2*(x*x + y*y)).matrix ();
+	    for (size_type r = 0; r < 3; ++r) {
+	      for (size_type c = 0; c < 3; ++c) {
+		out.row (3*r+c) = (work.row (3*r).array () *
+				   work.row (12+c).array () +
+				   work.row (3*r+1).array () *
+				   work.row (15+c).array () +
+				   work.row (3*r+2).array () *
+				   work.row (18+c).array ()).matrix ();
+	      }
+	      out.row (9+r) = work.row (9+r);
+	    }
+	  }
+	  break;
+	default:
+	  assert (false && "Unknown joint type.");
+	}
+      }
+    }
+  } // namespace model
+} // namespace hpp
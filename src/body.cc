@@ -23,7 +23,9 @@
 #include <hpp/model/body.hh>
 #include <hpp/model/joint.hh>
 #include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
 #include <hpp/model/object-factory.hh>
+#include "bounding-sphere.hh"
 
 namespace fcl {
   HPP_PREDEF_CLASS (CollisionGeometry);
@@ -51,6 +53,8 @@ namespace hpp {
 
     Body:: Body () : collisionInnerObjects_ (), collisionOuterObjects_ (),
 		     distanceInnerObjects_ (), distanceOuterObjects_ (),
+		     collisionOuterMobileObjects_ (),
+		     numberCollisionObstacles_ (0),
 		     joint_ (0x0), name_ (), localCom_ (), inertiaMatrix_ (),
 		     mass_ (0), radius_ (0)
     {
@@ -61,6 +65,7 @@ namespace hpp {
     Body::Body (const Body& body) :
       collisionInnerObjects_ (), collisionOuterObjects_ (),
       distanceInnerObjects_ (), distanceOuterObjects_ (),
+      collisionOuterMobileObjects_ (), numberCollisionObstacles_ (0),
       joint_ (0x0), name_ (body.name_), localCom_ (body.localCom_),
       inertiaMatrix_ (body.inertiaMatrix_), mass_ (body.mass_),
       radius_ (body.radius_)
@@ -69,6 +74,13 @@ namespace hpp {
 
     //-----------------------------------------------------------------------
 
+    Body::~Body ()
+    {
+      unregisterObstacles ();
+    }
+
+    //-----------------------------------------------------------------------
+
     BodyPtr_t Body::clone (const JointPtr_t& joint) const
     {
       BodyPtr_t newBody = new Body (*this);
@@ -160,6 +172,8 @@ namespace hpp {
 	  object->joint (joint ());
 	  updateRadius (object);
 	  collisionInnerObjects_.push_back (object);
+	  if (joint ()->robot ())
+	    joint ()->robot ()->collisionObjectsModified ();
 	}
       }
       if (distance) {
@@ -191,6 +205,14 @@ namespace hpp {
 	  hppDout (info, "adding " << object->name () << " to body "
 		   << this->name_ << " for collision");
 	  collisionOuterObjects_.push_back (object);
+	  DevicePtr_t robot (joint () ? joint ()->robot () : DevicePtr_t ());
+	  if (!object->joint () && robot) {
+	    robot->addObstacle (object, this);
+	    ++numberCollisionObstacles_;
+	  } else {
+	    collisionOuterMobileObjects_.push_back (object);
+	    if (robot) robot->collisionObjectsModified ();
+	  }
 	}
       }
       if (distance) {
@@ -216,8 +238,11 @@ namespace hpp {
       if (collision) {
 	ObjectVector_t::iterator it =
 	  findObject (collisionInnerObjects_, object->fcl ());
-	if (it != collisionInnerObjects_.end ())
+	if (it != collisionInnerObjects_.end ()) {
 	  collisionInnerObjects_.erase (it);
+	  if (joint ()->robot ())
+	    joint ()->robot ()->collisionObjectsModified ();
+	}
       }
       if (distance) {
 	ObjectVector_t::iterator it =
@@ -241,7 +266,17 @@ namespace hpp {
 	ObjectVector_t::iterator it =
 	  findObject (collisionOuterObjects_, object->fcl ());
 	if (it != collisionOuterObjects_.end ()) {
+	  const CollisionObjectPtr_t removed (*it);
 	  collisionOuterObjects_.erase (it);
+	  it = findObject (collisionOuterMobileObjects_, object->fcl ());
+	  if (it != collisionOuterMobileObjects_.end ()) {
+	    collisionOuterMobileObjects_.erase (it);
+	    if (joint ()->robot ())
+	      joint ()->robot ()->collisionObjectsModified ();
+	  } else {
+	    removeObstacle (removed);
+	    --numberCollisionObstacles_;
+	  }
 	}
       }
       if (distance) {
@@ -260,6 +295,35 @@ namespace hpp {
 
     //-----------------------------------------------------------------------
 
+    void Body::removeObstacle (const CollisionObjectPtr_t& object) const
+    {
+      // Copies of a device share the bodies of the device. Device::
+      // removeObstacle modifies the list of devices of the object.
+      const std::vector <DeviceWkPtr_t> devices (object->devices_);
+      for (std::vector <DeviceWkPtr_t>::const_iterator it = devices.begin ();
+	   it != devices.end (); ++it) {
+	DevicePtr_t device (it->lock ());
+	if (device) device->removeObstacle (object, this);
+      }
+    }
+
+    //-----------------------------------------------------------------------
+
+    void Body::unregisterObstacles ()
+    {
+      if (numberCollisionObstacles_ == 0) return;
+      for (ObjectVector_t::const_iterator it = collisionOuterObjects_.begin ();
+	   it != collisionOuterObjects_.end (); ++it) {
+	if (findObject (collisionOuterMobileObjects_, (*it)->fcl ()) !=
+	    collisionOuterMobileObjects_.end ()) continue;
+	removeObstacle (*it);
+	collisionOuterMobileObjects_.push_back (*it);
+      }
+      numberCollisionObstacles_ = 0;
+    }
+
+    //-----------------------------------------------------------------------
+
     const ObjectVector_t& Body::innerObjects (Request_t type) const
     {
       switch (type) {
@@ -290,23 +354,61 @@ namespace hpp {
 
     bool Body::collisionTest () const
     {
+      size_type numberPairs = 0, numberCulled = 0;
+      return collisionTest (numberPairs, numberCulled);
+    }
+
+    void Body::placeObjects (Request_t type) const
+    {
+      DevicePtr_t robot (joint () ? joint ()->robot () : DevicePtr_t ());
+      if (!robot) return;
+      const ObjectVector_t& inner (innerObjects (type));
+      if (!inner.empty ()) robot->placeObjects (inner.front (), type);
+      const ObjectVector_t& outer (outerObjects (type));
+      for (ObjectVector_t::const_iterator it = outer.begin ();
+	   it != outer.end (); ++it) {
+	robot->placeObjects (*it, type);
+      }
+    }
+
+    bool Body::collisionTest (size_type& numberPairs,
+			      size_type& numberCulled) const
+    {
+      // Forward kinematics only places objects if Device::GEOMETRY is
+      // selected.
+      placeObjects (COLLISION);
+      DevicePtr_t robot (joint () ? joint ()->robot () : DevicePtr_t ());
       fcl::CollisionRequest collisionRequest (1, false, false, 1, false, true,
 					      fcl::GST_INDEP);
       fcl::CollisionResult collisionResult;
       for (ObjectVector_t::const_iterator itInner =
 	     collisionInnerObjects_.begin ();
 	   itInner != collisionInnerObjects_.end (); ++itInner) {
+	const fcl::CollisionObject& inner (*(*itInner)->fcl ());
 	for (ObjectVector_t::const_iterator itOuter =
-	       collisionOuterObjects_.begin ();
-	     itOuter != collisionOuterObjects_.end (); ++itOuter) {
-	  if (fcl::collide ((*itInner)->fcl ().get (),
-			    (*itOuter)->fcl ().get (),
-			    collisionRequest, collisionResult) != 0) {
+	       collisionOuterMobileObjects_.begin ();
+	     itOuter != collisionOuterMobileObjects_.end (); ++itOuter) {
+	  const fcl::CollisionObject& outer (*(*itOuter)->fcl ());
+	  ++numberPairs;
+	  if (separatedBoundingSpheres
+	      (*inner.collisionGeometry (), inner.getTransform (),
+	       *outer.collisionGeometry (), outer.getTransform ())) {
+	    ++numberCulled;
+	    continue;
+	  }
+	  if (fcl::collide (&inner, &outer, collisionRequest,
+			    collisionResult) != 0) {
 	    hppDout (info, "Collision between " << (*itInner)->name ()
 		     << " and " << (*itOuter)->name ());
 	    return true;
 	  }
 	}
+	// Obstacles are stored in the obstacle tree of the device.
+	if (numberCollisionObstacles_ == 0 || !robot) continue;
+	if (robot->collisionTestObstacles (*itInner, inner.getTransform (),
+					   this, numberPairs, numberCulled)) {
+	  return true;
+	}
       }
       return false;
     }
@@ -315,12 +417,9 @@ namespace hpp {
 				 DistanceResults_t::size_type& offset)
     {
       fcl::DistanceRequest distanceRequest (true, 0, 0, fcl::GST_INDEP);
+      placeObjects (DISTANCE);
       for (ObjectVector_t::iterator itInner = distanceInnerObjects_.begin ();
 	   itInner != distanceInnerObjects_.end (); ++itInner) {
-	// Compute global position if inner object
-	fcl::Transform3f globalPosition = joint ()->currentTransformation ()*
-	  (*itInner)->positionInJointFrame ();
-	(*itInner)->fcl ()->setTransform (globalPosition);
 	for (ObjectVector_t::iterator itOuter = distanceOuterObjects_.begin ();
 	     itOuter != distanceOuterObjects_.end (); ++itOuter) {
 	  // Compute global position if inner object
@@ -0,0 +1,46 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#ifndef HPP_MODEL_SRC_BOUNDING_SPHERE_HH
+# define HPP_MODEL_SRC_BOUNDING_SPHERE_HH
+
+# include <hpp/fcl/collision_object.h>
+# include <hpp/model/fwd.hh>
+
+namespace hpp {
+  namespace model {
+    /// Whether the bounding spheres of two geometries are separated
+    /// \param geometry1, position1 first geometry and its position,
+    /// \param geometry2, position2 second geometry and its position.
+    ///
+    /// Bounding spheres are the spheres of center aabb_center and of radius
+    /// aabb_radius of the geometries. If they are separated, the geometries
+    /// do not collide and fcl::collide does not need to be called.
+    inline bool separatedBoundingSpheres
+    (const fcl::CollisionGeometry& geometry1, const Transform3f& position1,
+     const fcl::CollisionGeometry& geometry2, const Transform3f& position2)
+    {
+      const fcl::Vec3f d (position1.transform (geometry1.aabb_center) -
+			  position2.transform (geometry2.aabb_center));
+      const value_type radius = geometry1.aabb_radius + geometry2.aabb_radius;
+      return d.sqrLength () > radius * radius;
+    }
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_SRC_BOUNDING_SPHERE_HH
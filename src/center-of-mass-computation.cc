@@ -17,34 +17,16 @@
 #include "hpp/model/center-of-mass-computation.hh"
 
 #include <algorithm>
-#include <queue>
+#include <cassert>
+#include <stdexcept>
 
+#include "hpp/model/body.hh"
+#include "hpp/model/device-data.hh"
 #include "hpp/model/joint.hh"
-#include "hpp/model/device.hh"
+#include "hpp/model/kinematic-tree.hh"
 
 namespace hpp {
   namespace model {
-    struct CenterOfMassComputation::JointTreeElement_t {
-      JointTreeElement_t* parent;
-      JointPtr_t j;
-      fcl::Vec3f massCom_;
-      std::vector <JointTreeElement_t*> children;
-      JointTreeElement_t (const JointPtr_t& joint) :
-        parent (NULL), j (joint), children () {
-          massCom_.setValue (0);
-        }
-    };
-
-    struct CenterOfMassComputation::isJoint {
-      JointPtr_t j;
-      isJoint (const JointPtr_t& jt) : j (jt) {}
-
-      bool operator() (const JointTreeElement_t* e)
-      {
-        return e->j == j;
-      }
-    };
-
     CenterOfMassComputationPtr_t CenterOfMassComputation::create (
         const DevicePtr_t& d)
     {
@@ -53,77 +35,102 @@ namespace hpp {
 
     void CenterOfMassComputation::computeMass ()
     {
+      const KinematicTree& tree (device_->kinematicTree ());
+      for (std::size_t i = 0; i < ranks_.size (); ++i) {
+        BodyPtr_t body = tree [ranks_ [i]].joint->linkedBody ();
+        bodyMasses_ [i] = 0;
+        localComs_ [i].setValue (0);
+        if (body) {
+          bodyMasses_ [i] = body->mass ();
+          localComs_ [i] = body->localCenterOfMass ();
+        }
+        masses_ [i] = bodyMasses_ [i];
+      }
+      // Children are stored after their parent.
       mass_ = 0;
-      for (JointTreeList::iterator it = rootJointTrees_.begin ();
-          it != rootJointTrees_.end (); ++it) {
-        mass_ += (*it)->j->computeMass ();
+      for (size_type i = ranks_.size () - 1; i >= 0; --i) {
+        if (parents_ [i] >= 0) masses_ [parents_ [i]] += masses_ [i];
+        else mass_ += masses_ [i];
       }
       assert (mass_ > 0);
     }
 
     void CenterOfMassComputation::compute (const Device::Computation_t& flag)
+    {
+      compute (device_->data (), flag);
+    }
+
+    void CenterOfMassComputation::compute (const DeviceData& data,
+                                           const Device::Computation_t& flag)
     {
       assert (mass_ > 0);
+      const KinematicTree& tree (device_->kinematicTree ());
+      const std::vector <Transform3f>& positions (data.positions_);
+      // Mass times center of mass of the subtrees
+      for (std::size_t i = 0; i < ranks_.size (); ++i) {
+        massComs_ [i] = positions [ranks_ [i]].transform (localComs_ [i]) *
+          bodyMasses_ [i];
+      }
+      massCom_.setValue (0);
+      for (size_type i = ranks_.size () - 1; i >= 0; --i) {
+        if (parents_ [i] >= 0) massComs_ [parents_ [i]] += massComs_ [i];
+        else massCom_ += massComs_ [i];
+      }
       if (flag & Device::COM) {
-        massCom_.setValue (0);
-        for (JointTreeList::iterator it = rootJointTrees_.begin ();
-            it != rootJointTrees_.end (); ++it) {
-          (*it)->j->computeMassTimesCenterOfMass ();
-          massCom_ += (*it)->j->massCom_;
-        }
         com_ = massCom_ / mass_;
       }
       if (flag & Device::JACOBIAN) {
         jacobianCom_.setZero ();
-        for (JointTreeList::iterator it = jointTrees_.begin ();
-            it != jointTrees_.end (); ++it)
-          (*it)->j->writeComSubjacobian (jacobianCom_, mass_);
+        for (std::size_t i = 0; i < ranks_.size (); ++i) {
+          KinematicTree::writeComColumns (tree [ranks_ [i]],
+                                          positions [ranks_ [i]],
+                                          massComs_ [i], masses_ [i], mass_,
+                                          jacobianCom_);
+        }
       }
     }
 
     CenterOfMassComputation::CenterOfMassComputation (const DevicePtr_t& d) :
-      rootJointTrees_ (), jointTrees_ (), mass_ (-1),
-      jacobianCom_ (3, d->numberDof ())
+      device_ (d), selected_ (d->kinematicTree ().size (), false), ranks_ (),
+      parents_ (), bodyMasses_ (), localComs_ (), masses_ (), massComs_ (),
+      mass_ (-1), jacobianCom_ (3, d->numberDof ())
     {
       massCom_.setZero ();
+      com_.setZero ();
+      jacobianCom_.setZero ();
     }
 
     void CenterOfMassComputation::add (const JointPtr_t& j)
     {
-      JointTreeList::iterator itj =
-        std::find_if (jointTrees_.begin (), jointTrees_.end (), isJoint (j));
-      if (itj == jointTrees_.end ()) {
-        // TODO: Here we consider that all added joint are root joints. It
-        // means that you must consider all joints below this joints.
-        // A tree structure should be built to allow a finer selection of
-        // joints.
-        JointTreeElement_t* jtree = new JointTreeElement_t (j);
-        rootJointTrees_.push_back (jtree);
-        jointTrees_.push_back (jtree);
-        std::queue <JointTreeElement_t*> q;
-        q.push (jtree);
-        while (!q.empty ()) {
-          JointTreeElement_t* current = q.front ();
-          for (size_t r = 0; r < current->j->numberChildJoints (); ++r) {
-            JointTreeElement_t* next =
-              new JointTreeElement_t (current->j->childJoint (r));
-            next->parent = current;
-            current->children.push_back (next);
-            jointTrees_.push_back (next);
-            q.push (next);
-          }
-          q.pop ();
-        }
+      const KinematicTree& tree (device_->kinematicTree ());
+      const size_type rank = j->rankInTree ();
+      if (rank < 0 || rank >= tree.size () || tree [rank].joint != j) {
+        throw std::runtime_error ("Joint " + j->name () +
+                                  " does not belong to device " +
+                                  device_->name ());
       }
+      // Descendants of the joint are stored right after the joint.
+      std::fill (selected_.begin () + rank,
+                 selected_.begin () + tree [rank].subtreeEnd, true);
+      ranks_.clear ();
+      parents_.clear ();
+      std::vector <size_type> index (tree.size (), -1);
+      for (size_type i = 0; i < tree.size (); ++i) {
+        if (!selected_ [i]) continue;
+        index [i] = ranks_.size ();
+        ranks_.push_back (i);
+        const size_type parent = tree [i].parent;
+        parents_.push_back (parent >= 0 ? index [parent] : -1);
+      }
+      bodyMasses_.resize (ranks_.size ());
+      localComs_.resize (ranks_.size ());
+      masses_.resize (ranks_.size ());
+      massComs_.resize (ranks_.size ());
+      mass_ = -1;
     }
 
     CenterOfMassComputation::~CenterOfMassComputation ()
     {
-      for (JointTreeList::iterator it = jointTrees_.begin ();
-          it != jointTrees_.end ();) {
-        delete *it;
-        it = jointTrees_.erase (it);
-      }
     }
   }  //  namespace model
 }  //  namespace hpp
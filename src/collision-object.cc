@@ -20,6 +20,7 @@
 #include <hpp/util/debug.hh>
 #include <hpp/model/fwd.hh>
 #include <hpp/model/collision-object.hh>
+#include <hpp/model/device.hh>
 #include <hpp/model/joint.hh>
 
 namespace hpp {
@@ -79,6 +80,11 @@ namespace hpp {
       }
       positionInJointFrame_ = position;
       object_->setTransform (positionInJointFrame_);
+      for (std::vector <DeviceWkPtr_t>::const_iterator it = devices_.begin ();
+	   it != devices_.end (); ++it) {
+	DevicePtr_t device (it->lock ());
+	if (device) device->obstacleMoved (weakPtr_.lock ());
+      }
     }
 
   } // namespace model
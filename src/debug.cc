@@ -19,6 +19,7 @@
 #include <hpp/model/body.hh>
 #include <hpp/model/joint.hh>
 #include <hpp/model/device.hh>
+#include <hpp/model/device-data.hh>
 #include <hpp/model/humanoid-robot.hh>
 
 namespace hpp {
@@ -26,21 +27,21 @@ namespace hpp {
     ForwardGeometrys_t forwardGeometry (DevicePtr_t device, ConfigurationIn_t q)
     {
       ForwardGeometrys_t fgm;
-      DevicePtr_t d = device->clone ();
+      DeviceDataPtr_t data = DeviceData::create (device);
 
-      d->controlComputation (Device::JOINT_POSITION);
-      d->currentConfiguration (q);
-      d->computeForwardKinematics ();
+      data->controlComputation (Device::JOINT_POSITION);
+      data->currentConfiguration (q);
+      device->computeForwardKinematics (*data);
 
       std::string rn = device->name () + "/";
       Transform pos;
-      const JointVector_t& jv = d->getJointVector ();
+      const JointVector_t& jv = device->getJointVector ();
       JointVector_t::const_iterator itJ;
       for (itJ = jv.begin (); itJ != jv.end (); ++itJ) {
         BodyPtr_t b = (*itJ)->linkedBody ();
         if (b == NULL) continue;
         pos.name = rn + b->name();
-        Transform3f t = (*itJ)->currentTransformation () *
+        Transform3f t = data->position (*itJ) *
           (*itJ)->linkInJointFrame ();
         for (int i = 0; i < 3; ++i) pos.p[i] = t.getTranslation  ()[i];
         for (int i = 0; i < 4; ++i) pos.q[i] = t.getQuatRotation ()[i];
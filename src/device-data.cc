@@ -0,0 +1,245 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <hpp/model/device-data.hh>
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <hpp/model/kinematic-tree.hh>
+
+namespace hpp {
+  namespace model {
+    DeviceDataPtr_t DeviceData::create (const DeviceConstPtr_t& device)
+    {
+      DeviceData* ptr = new DeviceData ();
+      ptr->configuration_ = device->currentConfiguration ();
+      ptr->velocity_ = device->currentVelocity ();
+      ptr->acceleration_ = device->currentAcceleration ();
+      ptr->computedConfiguration_ = ptr->configuration_;
+      ptr->init (*device);
+      return DeviceDataPtr_t (ptr);
+    }
+
+    DeviceData::DeviceData () :
+      device_ (0x0), configuration_ (), velocity_ (), acceleration_ (),
+      computedConfiguration_ (),
+      computationFlag_ (Device::JOINT_POSITION), upToDate_ (false),
+      modifiedJoints_ (), positions_ (), jacobians_ (), jacobiansUpToDate_ (),
+      sparseJacobians_ (), sparseJacobiansUpToDate_ (), jacobianWork_ (),
+      massCom_ (), com_ (), comUpToDate_ (false), jacobianCom_ (3, 0),
+      jacobianComUpToDate_ (false), linearVelocities_ (),
+      angularVelocities_ (), velocitiesUpToDate_ (false), comVelocity_ (),
+      comVelocityUpToDate_ (false), linearAccelerations_ (),
+      angularAccelerations_ (), accelerationsUpToDate_ (false),
+      comAcceleration_ (), comAccelerationUpToDate_ (false),
+      linearDrifts_ (), angularDrifts_ (), driftsUpToDate_ (false),
+      comDrift_ (), comDriftUpToDate_ (false), numberCollisionPairs_ (0),
+      numberCulledPairs_ (0), adaptiveCollisionOrder_ (false),
+      collisionTests_ (), collisionTestsVersion_ (-1)
+    {
+      com_.setZero ();
+      comVelocity_.setZero ();
+      comAcceleration_.setZero ();
+      comDrift_.setZero ();
+    }
+
+    bool DeviceData::currentConfiguration (ConfigurationIn_t configuration)
+    {
+      if (configuration == configuration_) return false;
+      configuration_ = configuration;
+      upToDate_ = false;
+      return true;
+    }
+
+    void DeviceData::currentVelocity (vectorIn_t velocity)
+    {
+      velocity_ = velocity;
+      velocitiesUpToDate_ = false;
+      comVelocityUpToDate_ = false;
+      accelerationsUpToDate_ = false;
+      comAccelerationUpToDate_ = false;
+      driftsUpToDate_ = false;
+      comDriftUpToDate_ = false;
+    }
+
+    void DeviceData::currentAcceleration (vectorIn_t acceleration)
+    {
+      acceleration_ = acceleration;
+      accelerationsUpToDate_ = false;
+      comAccelerationUpToDate_ = false;
+    }
+
+    void DeviceData::frameJacobian (const JointConstPtr_t& joint,
+				    const Transform3f& positionInJoint,
+				    Frame_t frame, matrixOut_t jacobian) const
+    {
+      const JointJacobian_t& J (this->jacobian (joint));
+      assert (jacobian.rows () == 6 && jacobian.cols () == J.cols ());
+      const Transform3f& position (positions_ [joint->rankInTree ()]);
+      const fcl::Vec3f r (position.getRotation () *
+			  positionInJoint.getTranslation ());
+      const fcl::Matrix3f R (position.getRotation () *
+			     positionInJoint.getRotation ());
+      for (size_type c = 0; c < J.cols (); ++c) {
+	// Linear velocity of the frame origin and angular velocity
+	const fcl::Vec3f w (J (3, c), J (4, c), J (5, c));
+	const fcl::Vec3f v (fcl::Vec3f (J (0, c), J (1, c), J (2, c)) +
+			    w.cross (r));
+	for (size_type k = 0; k < 3; ++k) {
+	  if (frame == WORLD) {
+	    jacobian (k, c) = v [k];
+	    jacobian (k+3, c) = w [k];
+	  } else {
+	    jacobian (k, c) = R (0, k) * v [0] + R (1, k) * v [1] +
+	      R (2, k) * v [2];
+	    jacobian (k+3, c) = R (0, k) * w [0] + R (1, k) * w [1] +
+	      R (2, k) * w [2];
+	  }
+	}
+      }
+    }
+
+    void DeviceData::pointJacobian (const JointConstPtr_t& joint,
+				    const fcl::Vec3f& pointInJoint,
+				    Frame_t frame, matrixOut_t jacobian) const
+    {
+      const JointJacobian_t& J (this->jacobian (joint));
+      assert (jacobian.rows () == 3 && jacobian.cols () == J.cols ());
+      const fcl::Matrix3f& R (positions_ [joint->rankInTree ()].getRotation ());
+      const fcl::Vec3f r (R * pointInJoint);
+      for (size_type c = 0; c < J.cols (); ++c) {
+	const fcl::Vec3f w (J (3, c), J (4, c), J (5, c));
+	const fcl::Vec3f v (fcl::Vec3f (J (0, c), J (1, c), J (2, c)) +
+			    w.cross (r));
+	for (size_type k = 0; k < 3; ++k) {
+	  jacobian (k, c) = (frame == WORLD) ? v [k] :
+	    R (0, k) * v [0] + R (1, k) * v [1] + R (2, k) * v [2];
+	}
+      }
+    }
+
+    void DeviceData::controlComputation (const Device::Computation_t& flag)
+    {
+      // Newly selected quantities are computed by the next forward
+      // kinematics. Joint positions are not recomputed since the joints are
+      // not marked as modified.
+      if (flag & ~computationFlag_) upToDate_ = false;
+      computationFlag_ = flag;
+    }
+
+    void DeviceData::init (const Device& device)
+    {
+      device_ = &device;
+      const size_type size = device.kinematicTree ().size ();
+      const size_type numberDof = device.numberDof () -
+	device.extraConfigSpace ().dimension ();
+      Transform3f identity;
+      identity.setIdentity ();
+      positions_.assign (size, identity);
+      // Values are irrelevant since all joints are marked as modified.
+      computedConfiguration_ = configuration_;
+      // Dense Jacobians are allocated on first access.
+      jacobians_.assign (size, JointJacobian_t (6, 0));
+      jacobiansUpToDate_.assign (size, false);
+      sparseJacobians_.assign (size, SparseJacobian ());
+      sparseJacobiansUpToDate_.assign (size, false);
+      jacobianWork_.resize (6, device.kinematicTree ().numberDof ());
+      massCom_.resize (size);
+      linearVelocities_.resize (size);
+      angularVelocities_.resize (size);
+      linearAccelerations_.resize (size);
+      angularAccelerations_.resize (size);
+      linearDrifts_.resize (size);
+      angularDrifts_.resize (size);
+      jacobianCom_.resize (3, numberDof);
+      jacobianCom_.setZero ();
+      modifiedJoints_.resize (size);
+      paths_.clear ();
+      invalidate ();
+    }
+
+    size_type DeviceData::rankInTree (const JointConstPtr_t& joint) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      const size_type rank = joint->rankInTree ();
+      if (rank < 0 || rank >= tree.size () || tree [rank].joint != joint) {
+	throw std::runtime_error ("Joint " + joint->name () +
+				  " does not belong to the device.");
+      }
+      return rank;
+    }
+
+    const DeviceData::Ranks_t& DeviceData::path (const JointVector_t& joints)
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      key_.clear ();
+      for (JointVector_t::const_iterator it = joints.begin ();
+	   it != joints.end (); ++it) {
+	key_.push_back (rankInTree (*it));
+      }
+      std::map <Ranks_t, Ranks_t>::const_iterator itPath = paths_.find (key_);
+      if (itPath != paths_.end ()) return itPath->second;
+      // Mark joints and their ancestors
+      std::vector <bool> inPath (tree.size (), false);
+      for (Ranks_t::const_iterator it = key_.begin (); it != key_.end ();
+	   ++it) {
+	for (size_type i = *it; i >= 0 && !inPath [i]; i = tree [i].parent) {
+	  inPath [i] = true;
+	}
+      }
+      Ranks_t& path (paths_ [key_]);
+      for (size_type i = 0; i < tree.size (); ++i) {
+	if (inPath [i]) path.push_back (i);
+      }
+      return path;
+    }
+
+    void DeviceData::invalidate ()
+    {
+      modifiedJoints_.assign (modifiedJoints_.size (), true);
+      upToDate_ = false;
+      jacobiansUpToDate_.assign (jacobiansUpToDate_.size (), false);
+      sparseJacobiansUpToDate_.assign (sparseJacobiansUpToDate_.size (),
+				       false);
+      comUpToDate_ = false;
+      jacobianComUpToDate_ = false;
+      velocitiesUpToDate_ = false;
+      comVelocityUpToDate_ = false;
+      accelerationsUpToDate_ = false;
+      comAccelerationUpToDate_ = false;
+      driftsUpToDate_ = false;
+      comDriftUpToDate_ = false;
+    }
+
+    void DeviceData::collisionFound (std::size_t position) const
+    {
+      ++collisionTests_ [position].hits;
+      // Tests are sorted by decreasing number of collisions, then by rank
+      // in the default order, so that the order is deterministic.
+      while (position > 0) {
+	const Device::CollisionTest_t& test (collisionTests_ [position]);
+	const Device::CollisionTest_t& previous
+	  (collisionTests_ [position - 1]);
+	if (previous.hits > test.hits ||
+	    (previous.hits == test.hits && previous.index < test.index)) break;
+	std::swap (collisionTests_ [position], collisionTests_ [position - 1]);
+	--position;
+      }
+    }
+  } // namespace model
+} // namespace hpp
@@ -17,31 +17,36 @@
 // hpp-model  If not, see
 // <http://www.gnu.org/licenses/>.
 
+#include <algorithm>
 #include <hpp/util/debug.hh>
+#include <hpp/fcl/collision.h>
+#include <hpp/fcl/distance.h>
+#include <hpp/fcl/broadphase/broadphase_dynamic_AABB_tree.h>
 
 #include <hpp/model/collision-object.hh>
 #include <hpp/model/device.hh>
+#include <hpp/model/device-data.hh>
 #include <hpp/model/fcl-to-eigen.hh>
 #include <hpp/model/object-factory.hh>
 #include <hpp/model/gripper.hh>
+#include "bounding-sphere.hh"
 
 namespace hpp {
   namespace model {
 
-    static Transform3f I4;
-
     Device::Device(const std::string& name) :
       name_ (name), distances_ (),
       jointByName_ (),
-      jointVector_ (), rootJoint_ (0x0), numberDof_ (0),
-      configSize_ (0), currentConfiguration_ (configSize_),
-      currentVelocity_ (numberDof_), 	currentAcceleration_ (numberDof_),
-      com_ (), jacobianCom_ (3, 0), mass_ (0), upToDate_ (false),
-      computationFlag_ (ALL), collisionPairs_ (), distancePairs_ (),
-      grippers_ (), weakPtr_ ()
+      jointVector_ (), rootJoint_ (0x0), kinematicTree_ (),
+      numberDof_ (0), configSize_ (0), data_ (new DeviceData ()),
+      collisionPlaced_ (), distancePlaced_ (),
+      mass_ (0), collisionPairs_ (), distancePairs_ (),
+      collisionObstacles_ (), distanceObstacles_ (), obstacleBodies_ (),
+      obstacleTree_ (new fcl::DynamicAABBTreeCollisionManager),
+      collisionObjectsVersion_ (0),
+      grippers_ (), bulkConstruction_ (0), bulkFirstJoint_ (0), weakPtr_ ()
     {
-      com_.setZero ();
-      I4.setIdentity ();
+      data_->device_ = this;
     }
 
 
@@ -49,6 +54,11 @@ namespace hpp {
 
     Device::~Device()
     {
+      // Copies of the device share the joints of the original device.
+      for (JointVector_t::const_iterator it = jointVector_.begin ();
+	   it != jointVector_.end (); ++it) {
+	if ((*it)->device_ == this) (*it)->device_ = 0x0;
+      }
     }
 
     // ========================================================================
@@ -68,8 +78,12 @@ namespace hpp {
     {
       Device* ptr = new Device(*device);
       DevicePtr_t shPtr(ptr);
+      ptr->data_ = DeviceDataPtr_t (new DeviceData (*device->data_));
+      ptr->data_->device_ = ptr;
 
       ptr->init (shPtr);
+      // The copy should not share the obstacle tree of the device.
+      ptr->rebuildObstacleTree ();
       return shPtr;
     }
 
@@ -119,6 +133,113 @@ namespace hpp {
 
     // ========================================================================
 
+    void Device::updateObstacles ()
+    {
+      for (ObjectVector_t::const_iterator it = collisionObstacles_.begin ();
+	   it != collisionObstacles_.end (); ++it) {
+	(*it)->fcl ()->computeAABB ();
+      }
+      obstacleTree_->update ();
+    }
+
+    // ========================================================================
+
+    void Device::obstacleMoved (const CollisionObjectPtr_t& object)
+    {
+      fcl::CollisionObject* fclObject = object->fcl ().get ();
+      fclObject->computeAABB ();
+      obstacleTree_->update (fclObject);
+    }
+
+    // ========================================================================
+
+    void Device::addObstacle (const CollisionObjectPtr_t& object,
+			      const Body* body)
+    {
+      fcl::CollisionObject* fclObject = object->fcl ().get ();
+      ObstacleBodies_t::iterator it = obstacleBodies_.find (fclObject);
+      if (it == obstacleBodies_.end ()) {
+	fclObject->computeAABB ();
+	obstacleTree_->registerObject (fclObject);
+	collisionObstacles_.push_back (object);
+	// CollisionObject::move updates the tree.
+	object->devices_.push_back (weakPtr_);
+	it = obstacleBodies_.insert
+	  (std::make_pair (fclObject, std::vector <const Body*> ())).first;
+      }
+      if (std::find (it->second.begin (), it->second.end (), body) ==
+	  it->second.end ()) {
+	it->second.push_back (body);
+	collisionObjectsModified ();
+      }
+    }
+
+    // ========================================================================
+
+    void Device::removeObstacle (const CollisionObjectPtr_t& object,
+				 const Body* body)
+    {
+      fcl::CollisionObject* fclObject = object->fcl ().get ();
+      ObstacleBodies_t::iterator it = obstacleBodies_.find (fclObject);
+      if (it == obstacleBodies_.end ()) return;
+      it->second.erase (std::remove (it->second.begin (), it->second.end (),
+				     body), it->second.end ());
+      collisionObjectsModified ();
+      if (!it->second.empty ()) return;
+      obstacleTree_->unregisterObject (fclObject);
+      obstacleBodies_.erase (it);
+      for (ObjectVector_t::iterator itObj = collisionObstacles_.begin ();
+	   itObj != collisionObstacles_.end (); ++itObj) {
+	if ((*itObj)->fcl ().get () == fclObject) {
+	  std::vector <DeviceWkPtr_t>& devices ((*itObj)->devices_);
+	  for (std::vector <DeviceWkPtr_t>::iterator itDevice =
+		 devices.begin (); itDevice != devices.end (); ++itDevice) {
+	    if (itDevice->lock ().get () == this) {
+	      devices.erase (itDevice);
+	      break;
+	    }
+	  }
+	  collisionObstacles_.erase (itObj);
+	  break;
+	}
+      }
+    }
+
+    // ========================================================================
+
+    void Device::rebuildObstacleTree ()
+    {
+      const ObjectVector_t obstacles (collisionObstacles_);
+      collisionObstacles_.clear ();
+      obstacleBodies_.clear ();
+      obstacleTree_.reset (new fcl::DynamicAABBTreeCollisionManager);
+      // Obstacles are added in the same order.
+      for (ObjectVector_t::const_iterator it = obstacles.begin ();
+	   it != obstacles.end (); ++it) {
+	for (JointVector_t::const_iterator itJoint = jointVector_.begin ();
+	     itJoint != jointVector_.end (); ++itJoint) {
+	  BodyPtr_t body = (*itJoint)->linkedBody ();
+	  if (!body) continue;
+	  const ObjectVector_t& outer (body->collisionOuterObjects_);
+	  const ObjectVector_t& mobile (body->collisionOuterMobileObjects_);
+	  if (std::find (outer.begin (), outer.end (), *it) != outer.end () &&
+	      std::find (mobile.begin (), mobile.end (), *it) ==
+	      mobile.end ()) {
+	    addObstacle (*it, body);
+	  }
+	}
+      }
+    }
+
+    // ========================================================================
+
+    void Device::collisionObjectsModified ()
+    {
+      ++collisionObjectsVersion_;
+    }
+
+    // ========================================================================
+
     void Device::addCollisionPairs (const JointPtr_t& joint1,
 				    const JointPtr_t& joint2,
 				    Request_t type)
@@ -315,6 +436,7 @@ namespace hpp {
 
     void Device::updateDistances ()
     {
+      if (bulkConstruction_ > 0) return;
       JointVector_t joints = getJointVector ();
       JointVector_t::size_type size = 0;
       for (JointVector_t::iterator it = joints.begin (); it != joints.end ();
@@ -338,6 +460,7 @@ namespace hpp {
 	   ++it) {
 	BodyPtr_t body = (*it)->linkedBody ();
 	if (body) {
+	  // Objects are placed by the body.
 	  body->computeDistances (distances_, offset);
 	  assert (offset <= distances_.size ());
 	}
@@ -346,67 +469,582 @@ namespace hpp {
 
     // ========================================================================
 
-    bool Device::collisionTest () const
+    void Device::computeDistances (const DeviceData& data,
+				   DistanceResults_t& results) const
     {
+      fcl::DistanceRequest distanceRequest (true, 0, 0, fcl::GST_INDEP);
+      results.resize (distances_.size ());
+      DistanceResults_t::size_type offset = 0;
       for (JointVector_t::const_iterator itJoint = jointVector_.begin ();
 	   itJoint != jointVector_.end (); ++itJoint) {
 	BodyPtr_t body = (*itJoint)->linkedBody ();
-	if (body != 0x0) {
-	  if (body->collisionTest ()) {
-	    return true;
+	if (!body) continue;
+	const ObjectVector_t& inner = body->innerObjects (DISTANCE);
+	const ObjectVector_t& outer = body->outerObjects (DISTANCE);
+	for (ObjectVector_t::const_iterator itInner = inner.begin ();
+	     itInner != inner.end (); ++itInner) {
+	  Transform3f innerPosition = data.position (*itJoint) *
+	    (*itInner)->positionInJointFrame ();
+	  for (ObjectVector_t::const_iterator itOuter = outer.begin ();
+	       itOuter != outer.end (); ++itOuter) {
+	    assert (offset < results.size ());
+	    results [offset].fcl.clear ();
+	    fcl::distance ((*itInner)->fcl ()->collisionGeometry ().get (),
+			   innerPosition,
+			   (*itOuter)->fcl ()->collisionGeometry ().get (),
+			   objectPosition (data, *itOuter),
+			   distanceRequest, results [offset].fcl);
+	    results [offset].innerObject = *itInner;
+	    results [offset].outerObject = *itOuter;
+	    offset++;
 	  }
 	}
       }
-      return false;
     }
 
     // ========================================================================
 
-    void Device::computeForwardKinematics ()
+    Transform3f Device::objectPosition (const DeviceData& data,
+					const CollisionObjectPtr_t& object)
+      const
+    {
+      // Objects attached to a joint of the device move with the joint,
+      // other objects are static.
+      const JointPtr_t& joint = object->joint ();
+      if (rankInTree (joint) >= 0) {
+	return data.position (joint) * object->positionInJointFrame ();
+      }
+      return object->fcl ()->getTransform ();
+    }
+
+    size_type Device::rankInTree (const JointPtr_t& joint) const
     {
-      if (upToDate_) return;
-      computeJointPositions ();
-      if (computationFlag_ | JACOBIAN) {
-	computeJointJacobians ();
+      if (!joint) return -1;
+      const size_type rank = joint->rankInTree ();
+      if (rank >= 0 && rank < kinematicTree_.size () &&
+	  kinematicTree_ [rank].joint == joint) {
+	return rank;
       }
-      if (computationFlag_ | COM) {
-	computePositionCenterOfMass ();
+      return -1;
+    }
+
+    // ========================================================================
+
+    void Device::updateGeometry () const
+    {
+      for (size_type i = 0; i < kinematicTree_.size (); ++i) {
+	placeObjects (i, COLLISION);
+	placeObjects (i, DISTANCE);
       }
-      if (computationFlag_ | COM && computationFlag_ | JACOBIAN) {
-	computeJacobianCenterOfMass ();
+    }
+
+    void Device::placeObjects (size_type rank, Request_t type) const
+    {
+      std::vector <bool>& placed (type == COLLISION ? collisionPlaced_ :
+				  distancePlaced_);
+      if (placed [rank]) return;
+      placed [rank] = true;
+      const JointPtr_t& joint (kinematicTree_ [rank].joint);
+      BodyPtr_t body = joint->linkedBody ();
+      if (!body) return;
+      const ObjectVector_t& objects = body->innerObjects (type);
+      const ObjectVector_t& collisionObjects = body->innerObjects (COLLISION);
+      for (ObjectVector_t::const_iterator it = objects.begin ();
+	   it != objects.end (); ++it) {
+	// Objects used for collision and distance are placed once.
+	if (type == DISTANCE && collisionPlaced_ [rank] &&
+	    std::find (collisionObjects.begin (), collisionObjects.end (),
+		       *it) != collisionObjects.end ()) {
+	  continue;
+	}
+	(*it)->fcl ()->setTransform (joint->currentTransformation () *
+				     (*it)->positionInJointFrame ());
       }
-      // Update positions of bodies from position of joints.
-      JointVector_t jv = getJointVector ();
-      for (JointVector_t::iterator itJoint = jv.begin (); itJoint != jv.end ();
-	   ++itJoint) {
+    }
+
+    void Device::placeObjects (const CollisionObjectPtr_t& object,
+			       Request_t type) const
+    {
+      const size_type rank = rankInTree (object->joint ());
+      if (rank >= 0) placeObjects (rank, type);
+    }
+
+    // ========================================================================
+
+    namespace {
+      /// Collision test of an inner object against the obstacle tree
+      struct ObstacleQuery_t {
+	const fcl::CollisionGeometry* geometry;
+	const Transform3f* position;
+	/// Bounding box of the object in world frame
+	fcl::AABB aabb;
+	const Body* body;
+	const std::map <const fcl::CollisionObject*,
+			std::vector <const Body*> >* obstacleBodies;
+	fcl::CollisionRequest request;
+	fcl::CollisionResult result;
+	/// Number of obstacles tested by fcl::collide
+	size_type numberTested;
+      }; // struct ObstacleQuery_t
+
+      /// Test collision with the obstacles stored in a subtree of the
+      /// obstacle tree, the bounding box of which overlaps the bounding box
+      /// of the object.
+      bool collideObstacles (const fcl::NodeBase <fcl::AABB>* node,
+			     ObstacleQuery_t& query)
+      {
+	if (!node || !node->bv.overlap (query.aabb)) return false;
+	if (!node->isLeaf ()) {
+	  return collideObstacles (node->children [0], query) ||
+	    collideObstacles (node->children [1], query);
+	}
+	const fcl::CollisionObject* obstacle
+	  (static_cast <const fcl::CollisionObject*> (node->data));
+	// Only obstacles registered for the body are tested.
+	const std::vector <const Body*>& bodies
+	  (query.obstacleBodies->find (obstacle)->second);
+	if (std::find (bodies.begin (), bodies.end (), query.body) ==
+	    bodies.end ()) return false;
+	++query.numberTested;
+	return fcl::collide (query.geometry, *query.position,
+			     obstacle->collisionGeometry ().get (),
+			     obstacle->getTransform (), query.request,
+			     query.result) != 0;
+      }
+    } // namespace
+
+    bool Device::collisionTest (const DeviceData& data) const
+    {
+      if (data.adaptiveCollisionOrder_) return adaptiveCollisionTest (data);
+      fcl::CollisionRequest request (1, false, false, 1, false, true,
+				     fcl::GST_INDEP);
+      fcl::CollisionResult result;
+      for (JointVector_t::const_iterator itJoint = jointVector_.begin ();
+	   itJoint != jointVector_.end (); ++itJoint) {
 	BodyPtr_t body = (*itJoint)->linkedBody ();
-	if (body) {
-	  const ObjectVector_t& cbv =
-	    body->innerObjects (COLLISION);
-	  for (ObjectVector_t::const_iterator itInner = cbv.begin ();
-	       itInner != cbv.end (); ++itInner) {
-	    // Compute global position if inner object
-	    fcl::Transform3f globalPosition =
-	      (*itJoint)->currentTransformation ()*
-	      (*itInner)->positionInJointFrame ();
-	    (*itInner)->fcl ()->setTransform (globalPosition);
+	if (!body) continue;
+	const ObjectVector_t& inner = body->innerObjects (COLLISION);
+	const ObjectVector_t& outer = body->collisionOuterMobileObjects_;
+	const size_type numberObstacles = body->numberCollisionObstacles_;
+	for (ObjectVector_t::const_iterator itInner = inner.begin ();
+	     itInner != inner.end (); ++itInner) {
+	  Transform3f innerPosition = data.position (*itJoint) *
+	    (*itInner)->positionInJointFrame ();
+	  const fcl::CollisionGeometry& innerGeometry
+	    (*(*itInner)->fcl ()->collisionGeometry ());
+	  for (ObjectVector_t::const_iterator itOuter = outer.begin ();
+	       itOuter != outer.end (); ++itOuter) {
+	    const fcl::CollisionGeometry& outerGeometry
+	      (*(*itOuter)->fcl ()->collisionGeometry ());
+	    const Transform3f outerPosition (objectPosition (data, *itOuter));
+	    ++data.numberCollisionPairs_;
+	    if (separatedBoundingSpheres (innerGeometry, innerPosition,
+					  outerGeometry, outerPosition)) {
+	      ++data.numberCulledPairs_;
+	      continue;
+	    }
+	    if (fcl::collide (&innerGeometry, innerPosition, &outerGeometry,
+			      outerPosition, request, result) != 0) {
+	      hppDout (info, "Collision between " << (*itInner)->name ()
+		       << " and " << (*itOuter)->name ());
+	      return true;
+	    }
+	  }
+	  if (numberObstacles == 0) continue;
+	  if (collisionTestObstacles (*itInner, innerPosition, body,
+				      data.numberCollisionPairs_,
+				      data.numberCulledPairs_)) {
+	    return true;
 	  }
-	  const ObjectVector_t& dbv =
-	    body->innerObjects (DISTANCE);
-	  for (ObjectVector_t::const_iterator itInner = dbv.begin ();
-	       itInner != dbv.end (); ++itInner) {
-	    // Compute global position if inner object
-	    fcl::Transform3f globalPosition =
-	      (*itJoint)->currentTransformation ()*
-	      (*itInner)->positionInJointFrame ();
-	    (*itInner)->fcl ()->setTransform (globalPosition);
+	}
+      }
+      return false;
+    }
+
+    // ========================================================================
+
+    void Device::computeCollisionTests (CollisionTests_t& tests) const
+    {
+      tests.clear ();
+      CollisionTest_t test;
+      test.hits = 0;
+      for (JointVector_t::const_iterator itJoint = jointVector_.begin ();
+	   itJoint != jointVector_.end (); ++itJoint) {
+	BodyPtr_t body = (*itJoint)->linkedBody ();
+	if (!body) continue;
+	const ObjectVector_t& inner = body->innerObjects (COLLISION);
+	const ObjectVector_t& outer = body->collisionOuterMobileObjects_;
+	test.joint = *itJoint;
+	test.body = body;
+	for (ObjectVector_t::const_iterator itInner = inner.begin ();
+	     itInner != inner.end (); ++itInner) {
+	  test.inner = *itInner;
+	  for (ObjectVector_t::const_iterator itOuter = outer.begin ();
+	       itOuter != outer.end (); ++itOuter) {
+	    test.outer = *itOuter;
+	    test.index = tests.size ();
+	    tests.push_back (test);
 	  }
+	  if (body->numberCollisionObstacles_ == 0) continue;
+	  test.outer.reset ();
+	  test.index = tests.size ();
+	  tests.push_back (test);
+	}
+      }
+    }
+
+    bool Device::collisionTest (const DeviceData& data,
+				const CollisionTest_t& test,
+				size_type& numberPairs,
+				size_type& numberCulled) const
+    {
+      fcl::CollisionRequest request (1, false, false, 1, false, true,
+				     fcl::GST_INDEP);
+      Transform3f innerPosition = data.position (test.joint) *
+	test.inner->positionInJointFrame ();
+      const fcl::CollisionGeometry& innerGeometry
+	(*test.inner->fcl ()->collisionGeometry ());
+      if (test.outer) {
+	const fcl::CollisionGeometry& outerGeometry
+	  (*test.outer->fcl ()->collisionGeometry ());
+	const Transform3f outerPosition (objectPosition (data, test.outer));
+	++numberPairs;
+	if (separatedBoundingSpheres (innerGeometry, innerPosition,
+				      outerGeometry, outerPosition)) {
+	  ++numberCulled;
+	  return false;
+	}
+	fcl::CollisionResult result;
+	if (fcl::collide (&innerGeometry, innerPosition, &outerGeometry,
+			  outerPosition, request, result) != 0) {
+	  hppDout (info, "Collision between " << test.inner->name ()
+		   << " and " << test.outer->name ());
+	  return true;
+	}
+	return false;
+      }
+      return collisionTestObstacles (test.inner, innerPosition,
+				     test.body, numberPairs,
+				     numberCulled);
+    }
+
+    bool Device::collisionTestObstacles (const CollisionObjectPtr_t& object,
+					 const Transform3f& position,
+					 const Body* body,
+					 size_type& numberPairs,
+					 size_type& numberCulled) const
+    {
+      const size_type numberObstacles = body->numberCollisionObstacles_;
+      const fcl::CollisionGeometry& geometry
+	(*object->fcl ()->collisionGeometry ());
+      // Bounding box in world frame of the bounding sphere of the local
+      // bounding box. The geometry and the fcl object are not modified, so
+      // that several threads can test the same objects.
+      const fcl::Vec3f center (position.transform (geometry.aabb_center));
+      const fcl::Vec3f radius (geometry.aabb_radius, geometry.aabb_radius,
+			       geometry.aabb_radius);
+      ObstacleQuery_t query;
+      query.geometry = &geometry;
+      query.position = &position;
+      query.aabb = fcl::AABB (center - radius, center + radius);
+      query.body = body;
+      query.obstacleBodies = &obstacleBodies_;
+      query.request = fcl::CollisionRequest (1, false, false, 1, false, true,
+					     fcl::GST_INDEP);
+      query.numberTested = 0;
+      const bool collision = collideObstacles
+	(obstacleTree_->getTree ().getRoot (), query);
+      numberPairs += numberObstacles;
+      numberCulled += numberObstacles - query.numberTested;
+      if (collision) {
+	hppDout (info, "Collision between " << object->name ()
+		 << " and an obstacle");
+      }
+      return collision;
+    }
+
+    bool Device::adaptiveCollisionTest (const DeviceData& data) const
+    {
+      if (data.collisionTestsVersion_ != collisionObjectsVersion_) {
+	computeCollisionTests (data.collisionTests_);
+	data.collisionTestsVersion_ = collisionObjectsVersion_;
+      }
+      for (std::size_t i = 0; i < data.collisionTests_.size (); ++i) {
+	if (collisionTest (data, data.collisionTests_ [i],
+			   data.numberCollisionPairs_,
+			   data.numberCulledPairs_)) {
+	  data.collisionFound (i);
+	  return true;
 	}
       }
-      upToDate_ = true;
+      return false;
+    }
+
+    void Device::adaptiveCollisionOrder (bool enable)
+    {
+      data_->adaptiveCollisionOrder (enable);
+    }
+
+    // ========================================================================
+
+    bool Device::collisionTest () const
+    {
+      // Objects are tested at the joint positions stored in data_, fcl
+      // objects do not need to be placed.
+      return collisionTest (*data_);
+    }
+
+    // ========================================================================
+
+    const Configuration_t& Device::currentConfiguration () const
+    {
+      return data_->currentConfiguration ();
+    }
+
+    bool Device::currentConfiguration (ConfigurationIn_t configuration)
+    {
+      return data_->currentConfiguration (configuration);
+    }
+
+    const vector_t& Device::currentVelocity () const
+    {
+      return data_->currentVelocity ();
+    }
+
+    void Device::currentVelocity (vectorIn_t velocity)
+    {
+      data_->currentVelocity (velocity);
+    }
+
+    const vector_t& Device::currentAcceleration () const
+    {
+      return data_->currentAcceleration ();
+    }
+
+    void Device::currentAcceleration (vectorIn_t acceleration)
+    {
+      data_->currentAcceleration (acceleration);
+    }
+
+    // ========================================================================
+
+    const vector3_t& Device::positionCenterOfMass () const
+    {
+      return data_->positionCenterOfMass ();
+    }
+
+    const ComJacobian_t& Device::jacobianCenterOfMass () const
+    {
+      return data_->jacobianCenterOfMass ();
+    }
+
+    const vector3_t& Device::velocityCenterOfMass () const
+    {
+      return data_->velocityCenterOfMass ();
+    }
+
+    // ========================================================================
+
+    void Device::controlComputation (const Computation_t& flag)
+    {
+      data_->controlComputation (flag);
+    }
+
+    Device::Computation_t Device::computationFlag () const
+    {
+      return data_->computationFlag ();
+    }
+
+    const DeviceData& Device::data () const
+    {
+      return *data_;
+    }
+
+    // ========================================================================
+
+    void Device::computeForwardKinematics ()
+    {
+      computeForwardKinematics (*data_, true);
+      if (data_->computationFlag_ & GEOMETRY) {
+	updateGeometry ();
+      }
       hppDout (info, *this);
     }
 
+    void Device::computeForwardKinematics (DeviceData& data) const
+    {
+      computeForwardKinematics (data, false);
+    }
+
+    void Device::computeForwardKinematics (DeviceData& data,
+					   bool updateJoints) const
+    {
+      if (data.upToDate_) return;
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      assert (data.positions_.size () == nodes.size ());
+      // Record joints the configuration of which changed since last call.
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const size_type rank = nodes [i].rankInConfiguration;
+	const size_type size = nodes [i].configSize;
+	if (!data.modifiedJoints_ [i] &&
+	    data.configuration_.segment (rank, size) !=
+	    data.computedConfiguration_.segment (rank, size)) {
+	  data.modifiedJoints_ [i] = true;
+	}
+      }
+      data.computedConfiguration_ = data.configuration_;
+      // Descendants of a modified joint are stored right after the joint:
+      // update each subtree rooted at a modified joint in one range.
+      bool modified = false;
+      size_type i = 0;
+      while (i < (size_type) nodes.size ()) {
+	if (!data.modifiedJoints_ [i]) {
+	  ++i;
+	  continue;
+	}
+	const size_type end = nodes [i].subtreeEnd;
+	computeJointPositions (data, i, end);
+	if (updateJoints) {
+	  this->updateJoints (data, i, end);
+	}
+	std::fill (data.modifiedJoints_.begin () + i,
+		   data.modifiedJoints_.begin () + end, false);
+	std::fill (data.jacobiansUpToDate_.begin () + i,
+		   data.jacobiansUpToDate_.begin () + end, false);
+	std::fill (data.sparseJacobiansUpToDate_.begin () + i,
+		   data.sparseJacobiansUpToDate_.begin () + end, false);
+	modified = true;
+	i = end;
+      }
+      if (modified) {
+	data.comUpToDate_ = false;
+	data.jacobianComUpToDate_ = false;
+	data.velocitiesUpToDate_ = false;
+	data.comVelocityUpToDate_ = false;
+	data.accelerationsUpToDate_ = false;
+	data.comAccelerationUpToDate_ = false;
+	data.driftsUpToDate_ = false;
+	data.comDriftUpToDate_ = false;
+      }
+      data.upToDate_ = true;
+      // Compute selected quantities, others are computed on demand.
+      if (data.computationFlag_ & JACOBIAN) {
+	for (std::size_t i = 0; i < nodes.size (); ++i) {
+	  if (!data.jacobiansUpToDate_ [i]) computeJointJacobian (data, i);
+	}
+      }
+      if ((data.computationFlag_ & COM) && !data.comUpToDate_) {
+	computePositionCenterOfMass (data);
+      }
+      if ((data.computationFlag_ & COM) && (data.computationFlag_ & JACOBIAN) &&
+	  !data.jacobianComUpToDate_) {
+	computeJacobianCenterOfMass (data);
+      }
+      if ((data.computationFlag_ & VELOCITY) && !data.velocitiesUpToDate_) {
+	computeVelocities (data);
+      }
+      if ((data.computationFlag_ & COM) && (data.computationFlag_ & VELOCITY) &&
+	  !data.comVelocityUpToDate_) {
+	computeVelocityCenterOfMass (data);
+      }
+      if (data.computationFlag_ & ACCELERATION) {
+	if (!data.accelerationsUpToDate_) computeAccelerations (data);
+	if (!data.driftsUpToDate_) computeDrifts (data);
+	if (data.computationFlag_ & COM) {
+	  if (!data.comAccelerationUpToDate_) {
+	    computeAccelerationCenterOfMass (data);
+	  }
+	  if (!data.comDriftUpToDate_) computeDriftCenterOfMass (data);
+	}
+      }
+    }
+
+    void Device::computeForwardKinematics (const JointVector_t& joints)
+    {
+      computeForwardKinematics (*data_, joints, true);
+      if (data_->computationFlag_ & GEOMETRY) {
+	const DeviceData::Ranks_t& path (data_->path (joints));
+	for (DeviceData::Ranks_t::const_iterator it = path.begin ();
+	     it != path.end (); ++it) {
+	  placeObjects (*it, COLLISION);
+	  placeObjects (*it, DISTANCE);
+	}
+      }
+    }
+
+    void Device::computeForwardKinematics (DeviceData& data,
+					   const JointVector_t& joints) const
+    {
+      computeForwardKinematics (data, joints, false);
+    }
+
+    void Device::computeForwardKinematics (DeviceData& data,
+					   const JointVector_t& joints,
+					   bool updateJoints) const
+    {
+      const DeviceData::Ranks_t& path (data.path (joints));
+      if (data.upToDate_) return;
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      // Ancestors are stored before descendants in the path.
+      for (DeviceData::Ranks_t::const_iterator it = path.begin ();
+	   it != path.end (); ++it) {
+	const size_type i = *it;
+	const size_type rank = nodes [i].rankInConfiguration;
+	const size_type size = nodes [i].configSize;
+	if (!data.modifiedJoints_ [i] &&
+	    data.configuration_.segment (rank, size) ==
+	    data.computedConfiguration_.segment (rank, size)) {
+	  continue;
+	}
+	// Descendants of the joint are not up to date anymore. Those that
+	// belong to the path are updated in the next iterations.
+	const size_type end = nodes [i].subtreeEnd;
+	std::fill (data.modifiedJoints_.begin () + i + 1,
+		   data.modifiedJoints_.begin () + end, true);
+	std::fill (data.jacobiansUpToDate_.begin () + i,
+		   data.jacobiansUpToDate_.begin () + end, false);
+	std::fill (data.sparseJacobiansUpToDate_.begin () + i,
+		   data.sparseJacobiansUpToDate_.begin () + end, false);
+	data.computedConfiguration_.segment (rank, size) =
+	  data.configuration_.segment (rank, size);
+	computeJointPositions (data, i, i + 1);
+	if (updateJoints) {
+	  this->updateJoints (data, i, i + 1);
+	}
+	data.modifiedJoints_ [i] = false;
+	data.comUpToDate_ = false;
+	data.jacobianComUpToDate_ = false;
+	data.velocitiesUpToDate_ = false;
+	data.comVelocityUpToDate_ = false;
+	data.accelerationsUpToDate_ = false;
+	data.comAccelerationUpToDate_ = false;
+	data.driftsUpToDate_ = false;
+	data.comDriftUpToDate_ = false;
+      }
+      if (data.computationFlag_ & JACOBIAN) {
+	for (JointVector_t::const_iterator it = joints.begin ();
+	     it != joints.end (); ++it) {
+	  const size_type i = (*it)->rankInTree ();
+	  if (!data.jacobiansUpToDate_ [i]) computeJointJacobian (data, i);
+	}
+      }
+    }
+
+    void Device::updateJoints (const DeviceData& data, size_type begin,
+			       size_type end) const
+    {
+      // Copy joint positions. Objects attached to the joints are placed
+      // on demand.
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      for (size_type i = begin; i < end; ++i) {
+	nodes [i].joint->currentTransformation_ = data.positions_ [i];
+      }
+      std::fill (collisionPlaced_.begin () + begin,
+		 collisionPlaced_.begin () + end, false);
+      std::fill (distancePlaced_.begin () + begin,
+		 distancePlaced_.begin () + end, false);
+    }
+
     // ========================================================================
 
     void Device::registerJoint (const JointPtr_t& joint)
@@ -416,34 +1054,68 @@ namespace hpp {
       joint->rankInVelocity_ = numberDof_;
       numberDof_ += joint->numberDof ();
       configSize_ += joint->configSize ();
-      resizeState (joint);
       jointByName_ [joint->name ()] = joint;
-      resizeJacobians ();
+      resizeState (joint);
+      computeMass ();
+    }
+
+    void Device::beginBulkConstruction ()
+    {
+      if (bulkConstruction_ == 0) bulkFirstJoint_ = jointVector_.size ();
+      ++bulkConstruction_;
+    }
+
+    void Device::endBulkConstruction ()
+    {
+      if (bulkConstruction_ == 0) {
+	throw std::runtime_error ("Device " + name_ +
+				  " is not under bulk construction.");
+      }
+      if (--bulkConstruction_ > 0) return;
+      // Joints registered during bulk construction are in neutral
+      // configuration.
+      resizeState (0x0);
+      for (std::size_t i = bulkFirstJoint_; i < jointVector_.size (); ++i) {
+	const JointPtr_t& joint (jointVector_ [i]);
+	data_->configuration_.segment (joint->rankInConfiguration (),
+				       joint->configSize ()) =
+	  joint->neutralConfiguration ();
+      }
       computeMass ();
+      updateDistances ();
+      updateKinematicTree ();
     }
 
     void Device::resizeState (const JointPtr_t& joint)
     {
-      size_type oldSize = currentConfiguration_.size ();
+      if (bulkConstruction_ > 0) return;
+      size_type oldSize = data_->configuration_.size ();
       size_type newSize = configSize ();
-      Configuration_t q = currentConfiguration_;
-      currentConfiguration_.resize (newSize);
+      Configuration_t q = data_->configuration_;
+      data_->configuration_.resize (newSize);
       // if size of configuration increased, set last coordinates to 0
       if (newSize > oldSize) {
-	currentConfiguration_.head (oldSize) = q;
-	currentConfiguration_.tail (newSize - oldSize).setZero ();
+	data_->configuration_.head (oldSize) = q;
+	data_->configuration_.tail (newSize - oldSize).setZero ();
 	if (joint) {
-	  currentConfiguration_.tail (newSize - oldSize) =
+	  data_->configuration_.tail (newSize - oldSize) =
 	    joint->neutralConfiguration ();
 	}
       }
-      oldSize = currentVelocity_.size ();
+      // Partial forward kinematics compares configurations joint by joint.
+      oldSize = data_->computedConfiguration_.size ();
+      data_->computedConfiguration_.conservativeResize (newSize);
+      if (newSize > oldSize) {
+	data_->computedConfiguration_.tail (newSize - oldSize) =
+	  data_->configuration_.tail (newSize - oldSize);
+      }
+      oldSize = data_->velocity_.size ();
       newSize = numberDof ();
-      currentVelocity_.resize (newSize);
-      currentAcceleration_.resize (newSize);
+      data_->velocity_.conservativeResize (newSize);
+      data_->acceleration_.conservativeResize (newSize);
       if (newSize > oldSize) {
-	currentVelocity_.tail (newSize - oldSize).setZero ();
-	currentAcceleration_.tail (newSize - oldSize).setZero ();
+	data_->velocity_.tail (newSize - oldSize).setZero ();
+	data_->acceleration_.tail (newSize - oldSize).setZero ();
       }
     }
 
@@ -452,6 +1124,7 @@ namespace hpp {
       rootJoint_ = joint;
       registerJoint (joint);
       joint->robot (weakPtr_.lock ());
+      updateKinematicTree ();
     }
 
     void Device::rootJointPosition (const Transform3f& position)
@@ -460,6 +1133,17 @@ namespace hpp {
 	throw std::runtime_error ("The device has no root joint.");
       }
       rootJoint_->positionInParentFrame_ = position;
+      updateKinematicTree ();
+    }
+
+    void Device::updateKinematicTree ()
+    {
+      if (bulkConstruction_ > 0) return;
+      kinematicTree_.compile (rootJoint_);
+      data_->init (*this);
+      collisionObjectsModified ();
+      collisionPlaced_.assign (kinematicTree_.size (), false);
+      distancePlaced_.assign (kinematicTree_.size (), false);
     }
 
     JointPtr_t Device::rootJoint () const
@@ -498,45 +1182,167 @@ namespace hpp {
 				+ name);
     }
 
-    void Device::computeJointPositions ()
+    void Device::computeJointPositions (DeviceData& data, size_type begin,
+				       size_type end) const
     {
-      if (rootJoint_) {
-	rootJoint_->recursiveComputePosition (currentConfiguration_, I4);
-      }
+      kinematicTree_.computePositions (data.configuration_, begin, end,
+				       data.positions_);
     }
 
-    void Device::computeJointJacobians ()
+    void Device::computeJointJacobian (const DeviceData& data,
+				       size_type rank) const
     {
-      if (rootJoint_) {
-	rootJoint_->computeJacobian ();
-	for (JointVector_t::const_iterator it = jointVector_.begin ();
-	     it != jointVector_.end (); ++it) {
-	}
+      // Dense Jacobians are allocated on first access.
+      JointJacobian_t& jacobian (data.jacobians_ [rank]);
+      if (jacobian.cols () != kinematicTree_.numberDof ()) {
+	jacobian.resize (6, kinematicTree_.numberDof ());
+	jacobian.setZero ();
       }
+      kinematicTree_.computeJacobian (data.positions_, rank, jacobian);
+      data.jacobiansUpToDate_ [rank] = true;
+    }
+
+    void Device::computeSparseJointJacobian (const DeviceData& data,
+					     size_type rank) const
+    {
+      kinematicTree_.computeJacobian (data.positions_, rank,
+				      data.sparseJacobians_ [rank],
+				      data.jacobianWork_);
+      data.sparseJacobiansUpToDate_ [rank] = true;
     }
 
     void Device::computeMass ()
     {
+      if (bulkConstruction_ > 0) return;
       mass_ = 0;
       if (rootJoint_) {
 	mass_ = rootJoint_->computeMass ();
       }
     }
-    void Device::computePositionCenterOfMass ()
+    void Device::computePositionCenterOfMass (const DeviceData& data) const
     {
-      com_.setZero ();
-      if (rootJoint_) {
-	rootJoint_->computeMassTimesCenterOfMass ();
-	com_ = (1/mass_) * rootJoint_->massCom_;
+      data.com_.setZero ();
+      data.comUpToDate_ = true;
+      if (!rootJoint_) return;
+      // Accumulate mass times center of mass of subtrees from the leaves.
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	data.massCom_ [i].setValue (0);
+	BodyPtr_t body = nodes [i].joint->linkedBody ();
+	if (body) {
+	  data.massCom_ [i] = data.positions_ [i].transform
+	    (body->localCenterOfMass ()) * body->mass ();
+	}
       }
+      for (size_type i = nodes.size () - 1; i > 0; --i) {
+	data.massCom_ [nodes [i].parent] += data.massCom_ [i];
+      }
+      data.com_ = (1/mass_) * data.massCom_ [0];
     }
 
-    void Device::computeJacobianCenterOfMass ()
+    void Device::computeJacobianCenterOfMass (const DeviceData& data) const
     {
-      for (JointVector_t::iterator it = jointVector_.begin ();
-	   it != jointVector_.end (); ++it) {
-	(*it)->writeComSubjacobian (jacobianCom_, mass ());
+      // Requires mass times center of mass of subtrees.
+      if (!data.comUpToDate_) computePositionCenterOfMass (data);
+      data.jacobianComUpToDate_ = true;
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	nodes [i].joint->writeComSubjacobian (data.positions_ [i],
+					      data.massCom_ [i], mass (),
+					      data.jacobianCom_);
+      }
+    }
+
+    void Device::computeVelocities (const DeviceData& data) const
+    {
+      kinematicTree_.computeVelocities (data.positions_, data.velocity_,
+					data.linearVelocities_,
+					data.angularVelocities_,
+					data.jacobianWork_);
+      data.velocitiesUpToDate_ = true;
+    }
+
+    void Device::computeVelocityCenterOfMass (const DeviceData& data) const
+    {
+      if (!data.velocitiesUpToDate_) computeVelocities (data);
+      data.comVelocity_.setZero ();
+      data.comVelocityUpToDate_ = true;
+      if (!rootJoint_ || mass_ <= 0) return;
+      // Velocity of the center of mass of each body weighted by its mass
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	BodyPtr_t body = nodes [i].joint->linkedBody ();
+	if (!body || body->mass () == 0) continue;
+	const Transform3f& position (data.positions_ [i]);
+	const fcl::Vec3f r (position.getRotation () *
+			    body->localCenterOfMass ());
+	data.comVelocity_ += (data.linearVelocities_ [i] +
+			      data.angularVelocities_ [i].cross (r)) *
+	  body->mass ();
+      }
+      data.comVelocity_ = (1/mass_) * data.comVelocity_;
+    }
+
+    void Device::computeAccelerations (const DeviceData& data) const
+    {
+      if (!data.velocitiesUpToDate_) computeVelocities (data);
+      kinematicTree_.computeAccelerations
+	(data.positions_, data.velocity_, data.acceleration_,
+	 data.linearVelocities_, data.angularVelocities_,
+	 data.linearAccelerations_, data.angularAccelerations_,
+	 data.jacobianWork_);
+      data.accelerationsUpToDate_ = true;
+    }
+
+    void Device::computeDrifts (const DeviceData& data) const
+    {
+      if (!data.velocitiesUpToDate_) computeVelocities (data);
+      kinematicTree_.computeAccelerations
+	(data.positions_, data.velocity_, vector_t (),
+	 data.linearVelocities_, data.angularVelocities_,
+	 data.linearDrifts_, data.angularDrifts_,
+	 data.jacobianWork_);
+      data.driftsUpToDate_ = true;
+    }
+
+    void Device::computeAccelerationCenterOfMass (const DeviceData& data)
+      const
+    {
+      if (!data.accelerationsUpToDate_) computeAccelerations (data);
+      computeAccelerationCenterOfMass (data, data.linearAccelerations_,
+				       data.angularAccelerations_,
+				       data.comAcceleration_);
+      data.comAccelerationUpToDate_ = true;
+    }
+
+    void Device::computeDriftCenterOfMass (const DeviceData& data) const
+    {
+      if (!data.driftsUpToDate_) computeDrifts (data);
+      computeAccelerationCenterOfMass (data, data.linearDrifts_,
+				       data.angularDrifts_, data.comDrift_);
+      data.comDriftUpToDate_ = true;
+    }
+
+    void Device::computeAccelerationCenterOfMass
+    (const DeviceData& data, const std::vector <fcl::Vec3f>& linear,
+     const std::vector <fcl::Vec3f>& angular, vector3_t& result) const
+    {
+      result.setZero ();
+      if (!rootJoint_ || mass_ <= 0) return;
+      // Acceleration of the center of mass of each body weighted by its
+      // mass
+      const KinematicTree::Nodes_t& nodes (kinematicTree_.nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	BodyPtr_t body = nodes [i].joint->linkedBody ();
+	if (!body || body->mass () == 0) continue;
+	const Transform3f& position (data.positions_ [i]);
+	const fcl::Vec3f r (position.getRotation () *
+			    body->localCenterOfMass ());
+	const fcl::Vec3f& w (data.angularVelocities_ [i]);
+	result += (linear [i] + angular [i].cross (r) + w.cross (w.cross (r))) *
+	  body->mass ();
       }
+      result = (1/mass_) * result;
     }
 
     Configuration_t Device::neutralConfiguration () const
@@ -550,16 +1356,6 @@ namespace hpp {
       return nc;
     }
 
-    void Device::resizeJacobians ()
-    {
-      jacobianCom_.resize (3, numberDof_);
-      jacobianCom_.setZero ();
-      for (JointVector_t::iterator itJoint = jointVector_.begin ();
-	   itJoint != jointVector_.end () ; ++itJoint) {
-	(*itJoint)->jacobian_.resize (6, numberDof_);
-	(*itJoint)->jacobian_.setZero ();
-      }
-    }
     std::ostream& Device::print(std::ostream& os) const
     {
       os << "digraph G {" << std::endl;
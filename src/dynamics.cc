@@ -0,0 +1,514 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include <hpp/model/dynamics.hh>
+#include <Eigen/Geometry>
+#include <hpp/model/body.hh>
+#include <hpp/model/configuration.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/device-data.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/kinematic-tree.hh>
+
+namespace hpp {
+  namespace model {
+    namespace {
+      typedef Eigen::Matrix <value_type, 3, 1> Vector3_t;
+      typedef Eigen::Matrix <value_type, 3, 3> Matrix3_t;
+      /// Matrices of at most 6 columns allocated on the stack
+      typedef Eigen::Matrix <value_type, 6, Eigen::Dynamic, 0, 6, 6>
+      Matrix6N_t;
+      typedef Eigen::Matrix <value_type, Eigen::Dynamic, Eigen::Dynamic, 0,
+			     6, 6> MatrixN_t;
+
+      void toEigen (const fcl::Matrix3f& m, Matrix3_t& res)
+      {
+	for (size_type i = 0; i < 3; ++i) {
+	  for (size_type j = 0; j < 3; ++j) {
+	    res (i, j) = m (i, j);
+	  }
+	}
+      }
+
+      Vector3_t toVector (const fcl::Vec3f& v)
+      {
+	return Vector3_t (v [0], v [1], v [2]);
+      }
+    } // namespace
+
+    DynamicsPtr_t Dynamics::create (const DeviceConstPtr_t& device)
+    {
+      return DynamicsPtr_t (new Dynamics (device));
+    }
+
+    Dynamics::Dynamics (const DeviceConstPtr_t& device) :
+      device_ (device), data_ (DeviceData::create (device)),
+      numberDof_ (device->kinematicTree ().numberDof ()),
+      masses_ (device->kinematicTree ().size ()),
+      localComs_ (masses_.size ()), localInertias_ (masses_.size ()),
+      rotations_ (masses_.size ()), origins_ (masses_.size ()),
+      coms_ (masses_.size ()), inertias_ (masses_.size ()),
+      compositeMasses_ (masses_.size ()),
+      compositeMassComs_ (masses_.size ()),
+      compositeInertias_ (masses_.size ()), subspace_ (6, 6),
+      momentum_ (), momentumMatrix_ (6, numberDof_), momentumBias_ (),
+      totalMass_ (0), gravity_ (0, 0, -9.81), forces_ (masses_.size ()),
+      moments_ (masses_.size ()), torques_ (numberDof_),
+      motions_ (6, numberDof_), massMatrix_ (numberDof_, numberDof_),
+      factor_ (numberDof_, numberDof_), dofParents_ (numberDof_, -1),
+      biases_ (masses_.size ()), articulatedForces_ (masses_.size ()),
+      articulatedInertias_ (masses_.size ()),
+      projectedInertias_ (masses_.size ()),
+      projectedInverses_ (masses_.size ()), projectedTorques_ (numberDof_),
+      spatialAccelerations_ (masses_.size ()), acceleration_ (numberDof_),
+      configuration_ (device->configSize ()), velocityStep_ (numberDof_)
+    {
+      acceleration_.setZero ();
+      torques_.setZero ();
+      // Entries of degrees of freedom that are not on the same branch of
+      // the tree are never written.
+      massMatrix_.setZero ();
+      factor_.setZero ();
+      // The parent of the first degree of freedom of a joint is the last
+      // degree of freedom of the closest ancestor that has some.
+      const KinematicTree::Nodes_t& nodes (device->kinematicTree ().nodes ());
+      std::vector <size_type> lastDof (nodes.size (), -1);
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	size_type parentDof = node.parent < 0 ? -1 : lastDof [node.parent];
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  dofParents_ [node.rankInVelocity + k] = parentDof;
+	  assert (parentDof < node.rankInVelocity + k);
+	  parentDof = node.rankInVelocity + k;
+	}
+	lastDof [i] = parentDof;
+      }
+      momentum_.setZero ();
+      momentumMatrix_.setZero ();
+      momentumBias_.setZero ();
+      readBodies ();
+    }
+
+    void Dynamics::readBodies ()
+    {
+      const KinematicTree::Nodes_t& nodes (device_->kinematicTree ().nodes ());
+      assert (nodes.size () == masses_.size ());
+      totalMass_ = 0;
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	BodyPtr_t body = nodes [i].joint->linkedBody ();
+	if (body && body->mass () > 0) {
+	  masses_ [i] = body->mass ();
+	  localComs_ [i] = toVector (body->localCenterOfMass ());
+	  toEigen (body->inertiaMatrix (), localInertias_ [i]);
+	} else {
+	  masses_ [i] = 0;
+	  localComs_ [i].setZero ();
+	  localInertias_ [i].setZero ();
+	}
+	totalMass_ += masses_ [i];
+      }
+    }
+
+    void Dynamics::computeBodies (ConfigurationIn_t configuration,
+				  bool inertias)
+    {
+      data_->currentConfiguration (configuration);
+      device_->computeForwardKinematics (*data_);
+      const KinematicTree::Nodes_t& nodes (device_->kinematicTree ().nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const Transform3f& position (data_->positions_ [i]);
+	toEigen (position.getRotation (), rotations_ [i]);
+	origins_ [i] = toVector (position.getTranslation ());
+	coms_ [i] = rotations_ [i] * localComs_ [i] + origins_ [i];
+	if (inertias) {
+	  inertias_ [i] = rotations_ [i] * localInertias_ [i] *
+	    rotations_ [i].transpose ();
+	}
+      }
+    }
+
+    void Dynamics::computeCompositeInertias ()
+    {
+      const KinematicTree::Nodes_t& nodes (device_->kinematicTree ().nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const value_type m (masses_ [i]);
+	const Vector3_t& c (coms_ [i]);
+	compositeMasses_ [i] = m;
+	compositeMassComs_ [i] = c * m;
+	// Parallel axis theorem
+	compositeInertias_ [i] = inertias_ [i] +
+	  (Matrix3_t::Identity () * c.squaredNorm () - c * c.transpose ()) * m;
+      }
+      // Children are stored after their parent in the tree.
+      for (size_type i = nodes.size () - 1; i > 0; --i) {
+	const size_type parent = nodes [i].parent;
+	if (parent < 0) continue;
+	compositeMasses_ [parent] += compositeMasses_ [i];
+	compositeMassComs_ [parent] += compositeMassComs_ [i];
+	compositeInertias_ [parent] += compositeInertias_ [i];
+      }
+    }
+
+    void Dynamics::momentum (value_type mass, const Vector3_t& massCom,
+			     const Matrix3_t& inertia, const Vector3_t& linear,
+			     const Vector3_t& angular, vector6_t& momentum)
+    {
+      momentum.head <3> () = linear * mass + angular.cross (massCom);
+      momentum.tail <3> () = inertia * angular + massCom.cross (linear);
+    }
+
+    void Dynamics::computeCentroidalMomentum (ConfigurationIn_t configuration,
+					      vectorIn_t velocity)
+    {
+      assert (velocity.size () == numberDof_);
+      data_->currentVelocity (velocity);
+      computeBodies (configuration, true);
+      computeCompositeInertias ();
+      const KinematicTree& tree (device_->kinematicTree ());
+      const KinematicTree::Nodes_t& nodes (tree.nodes ());
+      momentumMatrix_.setZero ();
+      if (nodes.empty ()) {
+	momentum_.setZero ();
+	momentumBias_.setZero ();
+	return;
+      }
+      // Momentum and its derivative about the world origin
+      Vector3_t force (Vector3_t::Zero ()), torque (Vector3_t::Zero ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const value_type m (masses_ [i]);
+	if (m == 0) continue;
+	const JointPtr_t& joint (nodes [i].joint);
+	const Vector3_t omega (toVector (data_->angularVelocity (joint)));
+	const Vector3_t alpha (toVector (data_->angularDrift (joint)));
+	const Vector3_t r (coms_ [i] - origins_ [i]);
+	const Vector3_t acc (toVector (data_->linearDrift (joint)) +
+			     alpha.cross (r) + omega.cross (omega.cross (r)));
+	force += acc * m;
+	torque += inertias_ [i] * alpha +
+	  omega.cross (inertias_ [i] * omega) + coms_ [i].cross (acc * m);
+      }
+      // Column of each degree of freedom: the subtree of the joint moves
+      // rigidly with the velocity of the motion subspace.
+      vector6_t column;
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	if (node.numberDof == 0) continue;
+	tree.motionSubspace (data_->positions_, i, subspace_,
+			    data_->jacobianWork_);
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  const Vector3_t angular (subspace_.col (k).tail <3> ());
+	  // Velocity of the point of the subtree at the world origin
+	  const Vector3_t linear (subspace_.col (k).head <3> () +
+				  origins_ [i].cross (angular));
+	  momentum (compositeMasses_ [i], compositeMassComs_ [i],
+		    compositeInertias_ [i], linear, angular, column);
+	  momentumMatrix_.col (node.rankInVelocity + k) = column;
+	}
+      }
+      // Move reference point to the center of mass
+      Vector3_t com (Vector3_t::Zero ());
+      if (compositeMasses_ [0] > 0) {
+	com = compositeMassComs_ [0] / compositeMasses_ [0];
+      }
+      for (size_type j = 0; j < numberDof_; ++j) {
+	const Vector3_t p (momentumMatrix_.col (j).head <3> ());
+	momentumMatrix_.col (j).tail <3> () -= com.cross (p);
+      }
+      momentum_.noalias () = momentumMatrix_ * velocity;
+      momentumBias_.head <3> () = force;
+      momentumBias_.tail <3> () = torque - com.cross (force);
+    }
+
+    void Dynamics::computeInverseDynamics (ConfigurationIn_t configuration,
+					   vectorIn_t velocity,
+					   vectorIn_t acceleration)
+    {
+      assert (velocity.size () == numberDof_);
+      assert (acceleration.size () == numberDof_);
+      data_->currentVelocity (velocity);
+      data_->currentAcceleration (acceleration);
+      computeBodies (configuration, true);
+      const KinematicTree::Nodes_t& nodes (device_->kinematicTree ().nodes ());
+      const Vector3_t g (toVector (gravity_));
+      // Force and moment about the world origin applied to each body
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const value_type m (masses_ [i]);
+	if (m == 0) {
+	  forces_ [i].setZero ();
+	  moments_ [i].setZero ();
+	  continue;
+	}
+	const JointPtr_t& joint (nodes [i].joint);
+	const Vector3_t omega (toVector (data_->angularVelocity (joint)));
+	const Vector3_t alpha (toVector (data_->angularAcceleration (joint)));
+	const Vector3_t r (coms_ [i] - origins_ [i]);
+	const Vector3_t acc (toVector (data_->linearAcceleration (joint)) +
+			     alpha.cross (r) + omega.cross (omega.cross (r)));
+	forces_ [i] = (acc - g) * m;
+	moments_ [i] = inertias_ [i] * alpha +
+	  omega.cross (inertias_ [i] * omega) + coms_ [i].cross (forces_ [i]);
+      }
+      computeJointTorques ();
+    }
+
+    void Dynamics::computeGravityTorques (ConfigurationIn_t configuration)
+    {
+      computeBodies (configuration, false);
+      const Vector3_t g (toVector (gravity_));
+      for (std::size_t i = 0; i < masses_.size (); ++i) {
+	forces_ [i] = g * (-masses_ [i]);
+	moments_ [i] = coms_ [i].cross (forces_ [i]);
+      }
+      computeJointTorques ();
+    }
+
+    void Dynamics::computeJointTorques ()
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      const KinematicTree::Nodes_t& nodes (tree.nodes ());
+      // Children are stored after their parent in the tree.
+      for (size_type i = nodes.size () - 1; i > 0; --i) {
+	const size_type parent = nodes [i].parent;
+	if (parent < 0) continue;
+	forces_ [parent] += forces_ [i];
+	moments_ [parent] += moments_ [i];
+      }
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	if (node.numberDof == 0) continue;
+	tree.motionSubspace (data_->positions_, i, subspace_,
+			    data_->jacobianWork_);
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  const Vector3_t angular (subspace_.col (k).tail <3> ());
+	  const Vector3_t linear (subspace_.col (k).head <3> () +
+				  origins_ [i].cross (angular));
+	  torques_ [node.rankInVelocity + k] = linear.dot (forces_ [i]) +
+	    angular.dot (moments_ [i]);
+	}
+      }
+    }
+
+    void Dynamics::computeMotionSubspaces ()
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      const KinematicTree::Nodes_t& nodes (tree.nodes ());
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	if (node.numberDof == 0) continue;
+	tree.motionSubspace (data_->positions_, i, subspace_,
+			    data_->jacobianWork_);
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  const Vector3_t angular (subspace_.col (k).tail <3> ());
+	  motions_.col (node.rankInVelocity + k).head <3> () =
+	    subspace_.col (k).head <3> () + origins_ [i].cross (angular);
+	  motions_.col (node.rankInVelocity + k).tail <3> () = angular;
+	}
+      }
+    }
+
+    void Dynamics::computeMassMatrix (ConfigurationIn_t configuration)
+    {
+      computeBodies (configuration, true);
+      computeCompositeInertias ();
+      computeMotionSubspaces ();
+      const KinematicTree::Nodes_t& nodes (device_->kinematicTree ().nodes ());
+      // Momentum of the subtree of each joint moved by each degree of
+      // freedom projected on the motion subspaces of the joint and of its
+      // ancestors
+      vector6_t force;
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  const size_type col = node.rankInVelocity + k;
+	  momentum (compositeMasses_ [i], compositeMassComs_ [i],
+		    compositeInertias_ [i], motions_.col (col).head <3> (),
+		    motions_.col (col).tail <3> (), force);
+	  for (size_type row = col; row >= 0; row = dofParents_ [row]) {
+	    massMatrix_ (row, col) = massMatrix_ (col, row) =
+	      motions_.col (row).dot (force);
+	  }
+	}
+      }
+    }
+
+    void Dynamics::factorizeMassMatrix ()
+    {
+      for (size_type k = 0; k < numberDof_; ++k) {
+	for (size_type i = k; i >= 0; i = dofParents_ [i]) {
+	  factor_ (k, i) = massMatrix_ (k, i);
+	}
+      }
+      for (size_type k = numberDof_ - 1; k >= 0; --k) {
+	for (size_type i = dofParents_ [k]; i >= 0; i = dofParents_ [i]) {
+	  const value_type a (factor_ (k, i) / factor_ (k, k));
+	  for (size_type j = i; j >= 0; j = dofParents_ [j]) {
+	    factor_ (i, j) -= a * factor_ (k, j);
+	  }
+	  factor_ (k, i) = a;
+	}
+      }
+    }
+
+    void Dynamics::solveMassMatrix (matrixOut_t x) const
+    {
+      assert (x.rows () == numberDof_);
+      // Solve transpose (L) y = x
+      for (size_type i = numberDof_ - 1; i >= 0; --i) {
+	for (size_type j = dofParents_ [i]; j >= 0; j = dofParents_ [j]) {
+	  x.row (j) -= factor_ (i, j) * x.row (i);
+	}
+      }
+      // Solve D z = y
+      for (size_type i = 0; i < numberDof_; ++i) {
+	x.row (i) /= factor_ (i, i);
+      }
+      // Solve L x = z
+      for (size_type i = 0; i < numberDof_; ++i) {
+	for (size_type j = dofParents_ [i]; j >= 0; j = dofParents_ [j]) {
+	  x.row (i) -= factor_ (i, j) * x.row (j);
+	}
+      }
+    }
+
+    void Dynamics::computeForwardDynamics (ConfigurationIn_t configuration,
+					   vectorIn_t velocity,
+					   vectorIn_t torques)
+    {
+      assert (velocity.size () == numberDof_);
+      assert (torques.size () == numberDof_);
+      data_->currentVelocity (velocity);
+      computeBodies (configuration, true);
+      computeMotionSubspaces ();
+      const KinematicTree::Nodes_t& nodes (device_->kinematicTree ().nodes ());
+      // Spatial inertias, bias forces and accelerations of the bodies
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const JointPtr_t& joint (nodes [i].joint);
+	const Vector3_t& o (origins_ [i]);
+	const Vector3_t omega (toVector (data_->angularVelocity (joint)));
+	const Vector3_t vo (toVector (data_->linearVelocity (joint)));
+	const Vector3_t alpha (toVector (data_->angularDrift (joint)));
+	vector6_t v;
+	v.head <3> () = vo + o.cross (omega);
+	v.tail <3> () = omega;
+	biases_ [i].head <3> () = toVector (data_->linearDrift (joint)) -
+	  alpha.cross (o) - omega.cross (vo);
+	biases_ [i].tail <3> () = alpha;
+	const value_type m (masses_ [i]);
+	const Vector3_t h (coms_ [i] * m);
+	Matrix6_t& inertia (articulatedInertias_ [i]);
+	inertia.topLeftCorner <3, 3> () = Matrix3_t::Identity () * m;
+	inertia.topRightCorner <3, 3> () <<
+	  0, h [2], -h [1],
+	  -h [2], 0, h [0],
+	  h [1], -h [0], 0;
+	inertia.bottomLeftCorner <3, 3> () =
+	  inertia.topRightCorner <3, 3> ().transpose ();
+	inertia.bottomRightCorner <3, 3> () = inertias_ [i] +
+	  (Matrix3_t::Identity () * coms_ [i].squaredNorm () -
+	   coms_ [i] * coms_ [i].transpose ()) * m;
+	// Derivative of the momentum for a zero spatial acceleration
+	vector6_t momentum;
+	momentum.noalias () = inertia * v;
+	articulatedForces_ [i].head <3> () =
+	  omega.cross (momentum.head <3> ());
+	articulatedForces_ [i].tail <3> () =
+	  omega.cross (momentum.tail <3> ()) +
+	  v.head <3> ().cross (momentum.head <3> ());
+      }
+      // Bias accelerations relative to the parent
+      for (size_type i = nodes.size () - 1; i >= 0; --i) {
+	const size_type parent = nodes [i].parent;
+	if (parent >= 0) biases_ [i] -= biases_ [parent];
+      }
+      // Articulated inertias from the leaves to the root
+      Matrix6N_t S;
+      for (size_type i = nodes.size () - 1; i >= 0; --i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	const size_type nd = node.numberDof, rank = node.rankInVelocity;
+	const size_type parent = node.parent;
+	Matrix6_t& IA (articulatedInertias_ [i]);
+	vector6_t& pA (articulatedForces_ [i]);
+	if (nd > 0) {
+	  S = motions_.middleCols (rank, nd);
+	  Matrix6_t& U (projectedInertias_ [i]);
+	  Matrix6_t& Dinv (projectedInverses_ [i]);
+	  U.leftCols (nd).noalias () = IA * S;
+	  MatrixN_t D (S.transpose () * U.leftCols (nd));
+	  Dinv.topLeftCorner (nd, nd) = D.inverse ();
+	  projectedTorques_.segment (rank, nd) = torques.segment (rank, nd);
+	  projectedTorques_.segment (rank, nd).noalias () -=
+	    S.transpose () * pA;
+	  if (parent < 0) continue;
+	  const Matrix6N_t UDinv (U.leftCols (nd) *
+				  Dinv.topLeftCorner (nd, nd));
+	  IA.noalias () -= UDinv * U.leftCols (nd).transpose ();
+	  pA.noalias () += UDinv * projectedTorques_.segment (rank, nd);
+	}
+	if (parent < 0) continue;
+	pA.noalias () += IA * biases_ [i];
+	articulatedInertias_ [parent] += IA;
+	articulatedForces_ [parent] += pA;
+      }
+      // Accelerations from the root to the leaves. Gravity is taken into
+      // account by an opposite acceleration of the world.
+      vector6_t world;
+      world.head <3> () = -toVector (gravity_);
+      world.tail <3> ().setZero ();
+      for (std::size_t i = 0; i < nodes.size (); ++i) {
+	const KinematicTree::Node_t& node (nodes [i]);
+	const size_type nd = node.numberDof, rank = node.rankInVelocity;
+	vector6_t& A (spatialAccelerations_ [i]);
+	A = (node.parent < 0 ? world : spatialAccelerations_ [node.parent]) +
+	  biases_ [i];
+	if (nd == 0) continue;
+	projectedTorques_.segment (rank, nd).noalias () -=
+	  projectedInertias_ [i].leftCols (nd).transpose () * A;
+	acceleration_.segment (rank, nd).noalias () =
+	  projectedInverses_ [i].topLeftCorner (nd, nd) *
+	  projectedTorques_.segment (rank, nd);
+	A.noalias () += motions_.middleCols (rank, nd) *
+	  acceleration_.segment (rank, nd);
+      }
+    }
+
+    void Dynamics::step (ConfigurationOut_t configuration,
+			 vectorOut_t velocity, vectorIn_t torques,
+			 value_type timeStep)
+    {
+      computeForwardDynamics (configuration, velocity, torques);
+      velocity += acceleration_ * timeStep;
+      velocityStep_.noalias () = velocity * timeStep;
+      configuration_ = configuration;
+      model::integrate (*device_, configuration_, velocityStep_,
+			configuration);
+    }
+
+    vector3_t Dynamics::accelerationCenterOfMass (vectorIn_t acceleration)
+      const
+    {
+      assert (acceleration.size () == numberDof_);
+      vector3_t result (0, 0, 0);
+      if (totalMass_ <= 0) return result;
+      const Vector3_t a ((momentumMatrix_.topRows <3> () * acceleration +
+			  momentumBias_.head <3> ()) / totalMass_);
+      result [0] = a [0]; result [1] = a [1]; result [2] = a [2];
+      return result;
+    }
+  } // namespace model
+} // namespace hpp
@@ -22,6 +22,7 @@
 #include <hpp/model/body.hh>
 #include <hpp/model/collision-object.hh>
 #include <hpp/model/device.hh>
+#include <hpp/model/device-data.hh>
 #include <hpp/model/fcl-to-eigen.hh>
 #include <hpp/model/joint.hh>
 #include <hpp/model/joint-configuration.hh>
@@ -34,18 +35,17 @@ namespace hpp {
     Joint::Joint (const Transform3f& initialPosition,
 		  size_type configSize, size_type numberDof) :
       configuration_ (0x0), currentTransformation_ (initialPosition),
-      positionInParentFrame_ (), T3f_ (), mass_ (0), massCom_ (),
+      positionInParentFrame_ (), mass_ (0), massCom_ (),
       maximalDistanceToParent_ (0),
       configSize_ (configSize), numberDof_ (numberDof),
       initialPosition_ (initialPosition),
-      robot_ (), body_ (0x0),
+      robot_ (), device_ (0x0), body_ (0x0),
       name_ (), linkName_ (), children_ (), parent_ (0x0),
-      rankInConfiguration_ (-1),
+      rankInConfiguration_ (-1), rankInTree_ (-1),
       jacobian_ (), rankInParent_ (0)
     {
       positionInParentFrame_.setIdentity ();
       linkInJointFrame_.setIdentity ();
-      T3f_.setIdentity ();
       massCom_.setValue (0);
       neutralConfiguration_.resize (configSize);
       neutralConfiguration_.setZero ();
@@ -57,10 +57,11 @@ namespace hpp {
       linkInJointFrame_ (joint.linkInJointFrame_),
       maximalDistanceToParent_ (joint.maximalDistanceToParent_),
       configSize_ (joint.configSize_), numberDof_ (joint.numberDof_),
-      robot_ (), body_ (joint.body_ ? joint.body_->clone (this) : 0x0),
+      robot_ (), device_ (0x0),
+      body_ (joint.body_ ? joint.body_->clone (this) : 0x0),
       name_ (joint.name_), linkName_ (joint.linkName_),
       children_ (), parent_ (), rankInConfiguration_ (-1), rankInVelocity_ (-1),
-      rankInParent_ (-1)
+      rankInTree_ (-1), rankInParent_ (-1)
     {
       neutralConfiguration_ = joint.neutralConfiguration ();
     }
@@ -75,6 +76,22 @@ namespace hpp {
       return initialPosition_;
     }
 
+    const JointJacobian_t& Joint::jacobian () const
+    {
+      if (device_) {
+	return device_->data_->jacobian (this);
+      }
+      return jacobian_;
+    }
+
+    JointJacobian_t& Joint::jacobian ()
+    {
+      if (device_) {
+	return device_->data_->jacobian (this);
+      }
+      return jacobian_;
+    }
+
     const Transform3f& Joint::currentTransformation () const
     {
       return currentTransformation_;
@@ -89,6 +106,7 @@ namespace hpp {
 	  ("Cannot insert child joint to a joint not belonging to a device.");
       }
       joint->robot_ = robot;
+      joint->device_ = robot.get ();
       robot->registerJoint (joint);
       joint->rankInParent_ = children_.size ();
       children_.push_back (joint);
@@ -105,6 +123,16 @@ namespace hpp {
       // distance results.
       robot->updateDistances ();
       robot->computeMass ();
+      robot->updateKinematicTree ();
+    }
+
+    void Joint::positionInParentFrame (const Transform3f& p)
+    {
+      positionInParentFrame_ = p;
+      DevicePtr_t robot = robot_.lock ();
+      if (robot) {
+	robot->updateKinematicTree ();
+      }
     }
 
     void Joint::isBounded (size_type rank, bool bounded)
@@ -145,32 +173,14 @@ namespace hpp {
     }
 
     void Joint::setLinkedBody (const BodyPtr_t& body) {
+      // The devices should not refer to a detached body.
+      if (body_ && body_ != body) body_->unregisterObstacles ();
       body_ = body;
       body->joint (this);
       DevicePtr_t robot = robot_.lock ();
       if (robot) {
 	robot->computeMass ();
-      }
-    }
-
-    void Joint::recursiveComputePosition (ConfigurationIn_t configuration,
-					  const Transform3f& parentPosition)
-      const
-    {
-      computePosition (configuration, parentPosition, currentTransformation_);
-      for (std::vector <JointPtr_t>::const_iterator itJoint =
-	     children_.begin (); itJoint != children_.end (); ++itJoint) {
-	(*itJoint)->recursiveComputePosition
-	  (configuration, currentTransformation_);
-      }
-    }
-
-    void Joint::computeJacobian ()
-    {
-      for (ChildrenIterator it1 (this); !it1.end (); ++it1) {
-	for (ChildrenIterator it2 (*it1); !it2.end (); ++it2) {
-	  (*it1)->writeSubJacobian (*it2);
-	}
+	robot->collisionObjectsModified ();
       }
     }
 
@@ -235,12 +245,14 @@ namespace hpp {
       position = parentPosition * positionInParentFrame_;
     }
 
-    void JointAnchor::writeSubJacobian (const JointPtr_t&)
+    void JointAnchor::writeSubJacobian (const Transform3f&, const Transform3f&,
+					JointJacobian_t&) const
     {
     }
 
-    void JointAnchor::writeComSubjacobian (ComJacobian_t&,
-					   const value_type&)
+    void JointAnchor::writeComSubjacobian (const Transform3f&,
+					   const fcl::Vec3f&, const value_type&,
+					   ComJacobian_t&) const
     {
     }
 
@@ -280,8 +292,9 @@ namespace hpp {
 			   configuration [rankInConfiguration () + 1],
 			   configuration [rankInConfiguration () + 2],
 			   configuration [rankInConfiguration () + 3]);
-      T3f_.setQuatRotation (p);
-      position = parentPosition * positionInParentFrame_ * T3f_;
+      Transform3f T3f;
+      T3f.setQuatRotation (p);
+      position = parentPosition * positionInParentFrame_ * T3f;
     }
     static void cross (const fcl::Vec3f& x, JointJacobian_t& J, size_type row,
 		       size_type col)
@@ -299,39 +312,39 @@ namespace hpp {
       J (row + 1, col + 2) = -x [0]; J (row + 2, col + 1) = x [0];
     }
 
-    void JointSO3::writeSubJacobian (const JointPtr_t& child)
+    void JointSO3::writeSubJacobian (const Transform3f& position,
+				     const Transform3f& childPosition,
+				     JointJacobian_t& jacobian) const
     {
       size_type col = rankInVelocity ();
       // Set diagonal terms to 1
-      child->jacobian () (3,col) = child->jacobian () (4,col+1) =
-	child->jacobian () (5,col+2) = 1;
-      cross (currentTransformation_.getTranslation () -
-	     child->currentTransformation ().getTranslation (),
-	     child->jacobian (), 0, col);
+      jacobian (3,col) = jacobian (4,col+1) = jacobian (5,col+2) = 1;
+      cross (position.getTranslation () - childPosition.getTranslation (),
+	     jacobian, 0, col);
     }
 
-    void JointSO3::writeComSubjacobian (ComJacobian_t& jacobian,
-					const value_type& totalMass)
+    void JointSO3::writeComSubjacobian (const Transform3f& position,
+					const fcl::Vec3f& massCom,
+					const value_type& totalMass,
+					ComJacobian_t& jacobian) const
     {
       if (mass_ > 0) {
-	const fcl::Vec3f& center (currentTransformation_.getTranslation ());
-	com_ = massCom_ * (1/mass_);
+	const fcl::Vec3f& center (position.getTranslation ());
+	fcl::Vec3f com = massCom * (1/mass_);
 	size_type col = rankInVelocity ();
-	cross ((mass_/totalMass)*(center-com_), jacobian, (size_type) 0, col);
+	cross ((mass_/totalMass)*(center-com), jacobian, (size_type) 0, col);
       }
     }
 
     JointRotation::JointRotation (const Transform3f& initialPosition,
 				  size_type configSize, size_type numberDof) :
-      Joint (initialPosition, configSize, numberDof), R_ ()
+      Joint (initialPosition, configSize, numberDof)
     {
-      R_.setIdentity ();
     }
 
     JointRotation::JointRotation (const JointRotation& joint) :
-      Joint (joint), R_ ()
+      Joint (joint)
     {
-      R_.setIdentity ();
     }
 
     JointRotation::~JointRotation ()
@@ -345,35 +358,39 @@ namespace hpp {
 	positionInParentFrame ().getTranslation ().length ();
     }
 
-    void JointRotation::writeSubJacobian (const JointPtr_t& child)
+    void JointRotation::writeSubJacobian (const Transform3f& position,
+					  const Transform3f& childPosition,
+					  JointJacobian_t& jacobian) const
     {
       size_type col = rankInVelocity ();
       // Get rotation axis
-      axis_ = currentTransformation_.getRotation ().getColumn (0);
-      O2O1_ = currentTransformation_.getTranslation () -
-	child->currentTransformation ().getTranslation ();
-      cross_ = O2O1_.cross (axis_);
-      child->jacobian () (0, col) = cross_ [0];
-      child->jacobian () (1, col) = cross_ [1];
-      child->jacobian () (2, col) = cross_ [2];
-      child->jacobian () (3, col) = axis_ [0];
-      child->jacobian () (4, col) = axis_ [1];
-      child->jacobian () (5, col) = axis_ [2];
-    }
-
-    void JointRotation::writeComSubjacobian (ComJacobian_t& jacobian,
-					     const value_type& totalMass)
+      fcl::Vec3f axis = position.getRotation ().getColumn (0);
+      fcl::Vec3f O2O1 = position.getTranslation () -
+	childPosition.getTranslation ();
+      fcl::Vec3f cross = O2O1.cross (axis);
+      jacobian (0, col) = cross [0];
+      jacobian (1, col) = cross [1];
+      jacobian (2, col) = cross [2];
+      jacobian (3, col) = axis [0];
+      jacobian (4, col) = axis [1];
+      jacobian (5, col) = axis [2];
+    }
+
+    void JointRotation::writeComSubjacobian (const Transform3f& position,
+					     const fcl::Vec3f& massCom,
+					     const value_type& totalMass,
+					     ComJacobian_t& jacobian) const
     {
       if (mass_ > 0) {
 	size_type col = rankInVelocity ();
-	axis_ = currentTransformation_.getRotation ().getColumn (0);
-	com_ = massCom_ * (1/mass_);
-	const fcl::Vec3f& center (currentTransformation_.getTranslation ());
-	O2O1_ = center - com_;
-	cross_ = (mass_/totalMass) * O2O1_.cross (axis_);
-	jacobian (0, col) = cross_ [0];
-	jacobian (1, col) = cross_ [1];
-	jacobian (2, col) = cross_ [2];
+	fcl::Vec3f axis = position.getRotation ().getColumn (0);
+	fcl::Vec3f com = massCom * (1/mass_);
+	const fcl::Vec3f& center (position.getTranslation ());
+	fcl::Vec3f O2O1 = center - com;
+	fcl::Vec3f cross = (mass_/totalMass) * O2O1.cross (axis);
+	jacobian (0, col) = cross [0];
+	jacobian (1, col) = cross [1];
+	jacobian (2, col) = cross [2];
       }
     }
 
@@ -399,12 +416,15 @@ namespace hpp {
 				       const Transform3f& parentPosition,
 				       Transform3f& position) const
       {
-	cosAngle_ = configuration [rankInConfiguration ()];
-	sinAngle_ = configuration [rankInConfiguration () + 1];
-	R_ (1,1) = cosAngle_; R_ (1,2) = -sinAngle_;
-	R_ (2,1) = sinAngle_; R_ (2,2) = cosAngle_;
-	T3f_.setRotation (R_);
-	position = parentPosition * positionInParentFrame_ * T3f_;
+	const value_type cosAngle = configuration [rankInConfiguration ()];
+	const value_type sinAngle = configuration [rankInConfiguration () + 1];
+	fcl::Matrix3f R;
+	R.setIdentity ();
+	R (1,1) = cosAngle; R (1,2) = -sinAngle;
+	R (2,1) = sinAngle; R (2,2) = cosAngle;
+	Transform3f T3f;
+	T3f.setRotation (R);
+	position = parentPosition * positionInParentFrame_ * T3f;
       }
 
       Bounded::Bounded (const Transform3f& initialPosition) :
@@ -426,32 +446,33 @@ namespace hpp {
 				     const Transform3f& parentPosition,
 				     Transform3f& position) const
       {
-	angle_ = configuration [rankInConfiguration ()];
-	R_ (1,1) = cos (angle_); R_ (1,2) = -sin (angle_);
-	R_ (2,1) = sin (angle_); R_ (2,2) = cos (angle_);
-	T3f_.setRotation (R_);
-	position = parentPosition * positionInParentFrame_ * T3f_;
+	const value_type angle = configuration [rankInConfiguration ()];
+	fcl::Matrix3f R;
+	R.setIdentity ();
+	R (1,1) = cos (angle); R (1,2) = -sin (angle);
+	R (2,1) = sin (angle); R (2,2) = cos (angle);
+	Transform3f T3f;
+	T3f.setRotation (R);
+	position = parentPosition * positionInParentFrame_ * T3f;
       }
     } // namespace jointRotation
 
     template <size_type dimension>
     JointTranslation <dimension>::JointTranslation
     (const Transform3f& initialPosition) : Joint (initialPosition, dimension,
-						  dimension), t_ ()
+						  dimension)
     {
       if (dimension > 3 || dimension ==0) {
 	throw std::runtime_error
 	  ("Dimension of translation should be between 1 and 3.");
       }
       configuration_ = new TranslationJointConfig <dimension>;
-      t_.setValue (0);
     }
 
     template <size_type dimension>
     JointTranslation <dimension>::JointTranslation
-    (const JointTranslation <dimension>& joint) : Joint (joint), t_ ()
+    (const JointTranslation <dimension>& joint) : Joint (joint)
     {
-      t_.setValue (0);
     }
 
     template <size_type dimension>
@@ -562,43 +583,47 @@ namespace hpp {
     (ConfigurationIn_t configuration, const Transform3f& parentPosition,
      Transform3f& position) const
     {
-      t_ [0] = configuration [rankInConfiguration ()];
+      fcl::Vec3f t (0, 0, 0);
+      t [0] = configuration [rankInConfiguration ()];
       if (dimension >= 2) {
-	t_ [1] = configuration [rankInConfiguration () + 1];
+	t [1] = configuration [rankInConfiguration () + 1];
       }
       if (dimension >= 3) {
-	t_ [2] = configuration [rankInConfiguration () + 2];
+	t [2] = configuration [rankInConfiguration () + 2];
       }
-      T3f_.setTranslation (t_);
-      position = parentPosition * positionInParentFrame_ * T3f_;
+      Transform3f T3f;
+      T3f.setTranslation (t);
+      position = parentPosition * positionInParentFrame_ * T3f;
     }
 
     template <size_type dimension>
     void JointTranslation <dimension>::writeSubJacobian
-    (const JointPtr_t& child)
+    (const Transform3f& position, const Transform3f&,
+     JointJacobian_t& jacobian) const
     {
       size_type col = rankInVelocity ();
       // Get translation axis
       for (unsigned int i=0; i<dimension; ++i) {
-	axis_[i] = currentTransformation_.getRotation ().getColumn (i);
-	child->jacobian () (0, col+i) = axis_ [i][0];
-	child->jacobian () (1, col+i) = axis_ [i][1];
-	child->jacobian () (2, col+i) = axis_ [i][2];
+	fcl::Vec3f axis = position.getRotation ().getColumn (i);
+	jacobian (0, col+i) = axis [0];
+	jacobian (1, col+i) = axis [1];
+	jacobian (2, col+i) = axis [2];
       }
     }
 
     template <size_type dimension>
     void JointTranslation <dimension>::writeComSubjacobian
-    (ComJacobian_t& jacobian, const value_type& totalMass)
+    (const Transform3f& position, const fcl::Vec3f&,
+     const value_type& totalMass, ComJacobian_t& jacobian) const
     {
       if (mass_ > 0) {
 	size_type col = rankInVelocity ();
 	// Get translation axis
 	for (unsigned int i=0; i<dimension; ++i) {
-	  axis_ [i] = currentTransformation_.getRotation ().getColumn (i);
-	  jacobian (0, col+i) = (mass_/totalMass) * axis_ [i][0];
-	  jacobian (1, col+i) = (mass_/totalMass) * axis_ [i][1];
-	  jacobian (2, col+i) = (mass_/totalMass) * axis_ [i][2];
+	  fcl::Vec3f axis = position.getRotation ().getColumn (i);
+	  jacobian (0, col+i) = (mass_/totalMass) * axis [0];
+	  jacobian (1, col+i) = (mass_/totalMass) * axis [1];
+	  jacobian (2, col+i) = (mass_/totalMass) * axis [2];
 	}
       }
     }
@@ -0,0 +1,494 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <hpp/model/kinematic-tree.hh>
+#include <hpp/model/children-iterator.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/sparse-jacobian.hh>
+#include "sincos.hh"
+
+namespace hpp {
+  namespace model {
+    JointType_t jointType (const JointConstPtr_t& joint)
+    {
+      if (dynamic_cast <JointAnchorConstPtr_t> (joint)) return JOINT_ANCHOR;
+      if (dynamic_cast <JointSO3ConstPtr_t> (joint)) return JOINT_SO3;
+      if (dynamic_cast <const jointRotation::Bounded*> (joint))
+	return JOINT_ROTATION_BOUNDED;
+      if (dynamic_cast <const jointRotation::UnBounded*> (joint))
+	return JOINT_ROTATION_UNBOUNDED;
+      if (dynamic_cast <JointTranslationConstPtr_t> (joint))
+	return JOINT_TRANSLATION_1;
+      if (dynamic_cast <JointTranslation2ConstPtr_t> (joint))
+	return JOINT_TRANSLATION_2;
+      if (dynamic_cast <JointTranslation3ConstPtr_t> (joint))
+	return JOINT_TRANSLATION_3;
+      return JOINT_GENERIC;
+    }
+
+    KinematicTree::KinematicTree () : nodes_ (), numberDof_ (0)
+    {
+    }
+
+    void KinematicTree::compile (const JointPtr_t& rootJoint)
+    {
+      nodes_.clear ();
+      numberDof_ = 0;
+      if (!rootJoint) return;
+      for (ChildrenIterator it (rootJoint); !it.end (); ++it) {
+	JointPtr_t joint = *it;
+	Node_t node;
+	node.joint = joint;
+	node.type = jointType (joint);
+	node.parent = -1;
+	if (joint != rootJoint) {
+	  node.parent = joint->parentJoint ()->rankInTree_;
+	}
+	node.subtreeEnd = -1;
+	node.rankInConfiguration = joint->rankInConfiguration ();
+	node.rankInVelocity = joint->rankInVelocity ();
+	node.configSize = joint->configSize ();
+	node.numberDof = joint->numberDof ();
+	node.rotationInParent = joint->positionInParentFrame ().getRotation ();
+	node.translationInParent =
+	  joint->positionInParentFrame ().getTranslation ();
+	joint->rankInTree_ = nodes_.size ();
+	numberDof_ += node.numberDof;
+	nodes_.push_back (node);
+      }
+      // Descendants of a joint are stored right after the joint.
+      for (size_type i = nodes_.size () - 1; i >= 0; --i) {
+	if (nodes_ [i].subtreeEnd < 0) nodes_ [i].subtreeEnd = i + 1;
+	size_type parent = nodes_ [i].parent;
+	if (parent >= 0 && nodes_ [parent].subtreeEnd < 0) {
+	  nodes_ [parent].subtreeEnd = nodes_ [i].subtreeEnd;
+	}
+      }
+    }
+
+    // Compute R * Rq where Rq is the rotation matrix of quaternion
+    // (w, x, y, z).
+    static void rotateQuaternion (fcl::Matrix3f& R, value_type w, value_type x,
+				  value_type y, value_type z)
+    {
+      const value_type Rq [3][3] = {
+	{1 - 2*(y*y + z*z), 2*(x*y - z*w), 2*(x*z + y*w)},
+	{2*(x*y + z*w), 1 - 2*(x*x + z*z), 2*(y*z - x*w)},
+	{2*(x*z - y*w), 2*(y*z + x*w), 1 - 2*(x*x + y*y)}
+      };
+      for (size_type r = 0; r < 3; ++r) {
+	const value_type a = R (r, 0), b = R (r, 1), c = R (r, 2);
+	for (size_type k = 0; k < 3; ++k) {
+	  R (r, k) = a * Rq [0][k] + b * Rq [1][k] + c * Rq [2][k];
+	}
+      }
+    }
+
+    // Compute R * Rx where Rx is the rotation about x-axis of given cosine
+    // and sine.
+    static void rotateX (fcl::Matrix3f& R, value_type cosAngle,
+			 value_type sinAngle)
+    {
+      for (size_type r = 0; r < 3; ++r) {
+	const value_type a = R (r, 1), b = R (r, 2);
+	R (r, 1) = cosAngle * a + sinAngle * b;
+	R (r, 2) = cosAngle * b - sinAngle * a;
+      }
+    }
+
+    void KinematicTree::computePositions
+    (ConfigurationIn_t configuration, std::vector <Transform3f>& positions)
+      const
+    {
+      positions.resize (nodes_.size ());
+      computePositions (configuration, 0, nodes_.size (), positions);
+    }
+
+    void KinematicTree::computePositions
+    (ConfigurationIn_t configuration, size_type begin, size_type end,
+     std::vector <Transform3f>& positions) const
+    {
+      assert (positions.size () == nodes_.size ());
+      // Sines and cosines of bounded rotations are computed by blocks of
+      // joints in a single vectorized call.
+      const size_type blockSize = 64;
+      value_type angles [blockSize], sines [blockSize], cosines [blockSize];
+      size_type blockEnd = begin, nbAngles = 0, iAngle = 0;
+      fcl::Matrix3f R;
+      fcl::Vec3f T;
+      for (size_type i = begin; i < end; ++i) {
+	if (i == blockEnd) {
+	  for (nbAngles = 0; blockEnd < end && nbAngles < blockSize;
+	       ++blockEnd) {
+	    if (nodes_ [blockEnd].type == JOINT_ROTATION_BOUNDED) {
+	      angles [nbAngles++] =
+		configuration [nodes_ [blockEnd].rankInConfiguration];
+	    }
+	  }
+	  sinCos (nbAngles, angles, sines, cosines);
+	  iAngle = 0;
+	}
+	const Node_t& node (nodes_ [i]);
+	const size_type rank = node.rankInConfiguration;
+	if (node.type == JOINT_GENERIC) {
+	  Transform3f parentPosition;
+	  parentPosition.setIdentity ();
+	  if (node.parent >= 0) parentPosition = positions [node.parent];
+	  node.joint->computePosition (configuration, parentPosition,
+				       positions [i]);
+	  continue;
+	}
+	// Parent position times position in parent frame
+	if (node.parent < 0) {
+	  R = node.rotationInParent;
+	  T = node.translationInParent;
+	} else {
+	  const fcl::Matrix3f& Rp (positions [node.parent].getRotation ());
+	  R = Rp * node.rotationInParent;
+	  T = Rp * node.translationInParent +
+	    positions [node.parent].getTranslation ();
+	}
+	// Joint motion
+	switch (node.type) {
+	case JOINT_ANCHOR:
+	  break;
+	case JOINT_SO3:
+	  rotateQuaternion (R, configuration [rank],
+			    configuration [rank + 1],
+			    configuration [rank + 2],
+			    configuration [rank + 3]);
+	  break;
+	case JOINT_ROTATION_BOUNDED:
+	  rotateX (R, cosines [iAngle], sines [iAngle]);
+	  ++iAngle;
+	  break;
+	case JOINT_ROTATION_UNBOUNDED:
+	  rotateX (R, configuration [rank], configuration [rank + 1]);
+	  break;
+	case JOINT_TRANSLATION_3:
+	  T += R.getColumn (2) * configuration [rank + 2];
+	  // fall through
+	case JOINT_TRANSLATION_2:
+	  T += R.getColumn (1) * configuration [rank + 1];
+	  // fall through
+	case JOINT_TRANSLATION_1:
+	  T += R.getColumn (0) * configuration [rank];
+	  break;
+	default:
+	  assert (false && "Unknown joint type.");
+	}
+	positions [i].setTransform (R, T);
+      }
+    }
+
+    void KinematicTree::writeColumns (const Node_t& node,
+				      const Transform3f& position,
+				      const Transform3f& childPosition,
+				      JointJacobian_t& jacobian,
+				      size_type col, JointJacobian_t& work)
+    {
+      const fcl::Matrix3f& R (position.getRotation ());
+      switch (node.type) {
+      case JOINT_ANCHOR:
+	break;
+      case JOINT_SO3:
+	{
+	  const fcl::Vec3f x (position.getTranslation () -
+			      childPosition.getTranslation ());
+	  jacobian (3, col) = jacobian (4, col+1) = jacobian (5, col+2) = 1;
+	  jacobian (0, col+1) = -x [2]; jacobian (1, col) = x [2];
+	  jacobian (0, col+2) = x [1]; jacobian (2, col) = -x [1];
+	  jacobian (1, col+2) = -x [0]; jacobian (2, col+1) = x [0];
+	}
+	break;
+      case JOINT_ROTATION_BOUNDED:
+      case JOINT_ROTATION_UNBOUNDED:
+	{
+	  const fcl::Vec3f axis (R.getColumn (0));
+	  const fcl::Vec3f cross
+	    ((position.getTranslation () -
+	      childPosition.getTranslation ()).cross (axis));
+	  for (size_type r = 0; r < 3; ++r) {
+	    jacobian (r, col) = cross [r];
+	    jacobian (r+3, col) = axis [r];
+	  }
+	}
+	break;
+      case JOINT_TRANSLATION_3:
+      case JOINT_TRANSLATION_2:
+      case JOINT_TRANSLATION_1:
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  for (size_type r = 0; r < 3; ++r) {
+	    jacobian (r, col+k) = R (r, k);
+	  }
+	}
+	break;
+      default:
+	// Joint::writeSubJacobian writes the columns starting at the rank
+	// of the joint in the velocity vector.
+	if (col == node.rankInVelocity) {
+	  node.joint->writeSubJacobian (position, childPosition, jacobian);
+	} else {
+	  assert (work.cols () >= node.rankInVelocity + node.numberDof);
+	  work.middleCols (node.rankInVelocity, node.numberDof).setZero ();
+	  node.joint->writeSubJacobian (position, childPosition, work);
+	  jacobian.middleCols (col, node.numberDof) =
+	    work.middleCols (node.rankInVelocity, node.numberDof);
+	}
+      }
+    }
+
+    void KinematicTree::motionSubspace
+    (const std::vector <Transform3f>& positions, size_type rank,
+     JointJacobian_t& subspace, JointJacobian_t& work) const
+    {
+      const Node_t& node (nodes_ [rank]);
+      assert (subspace.cols () >= node.numberDof);
+      subspace.leftCols (node.numberDof).setZero ();
+      writeColumns (node, positions [rank], positions [rank], subspace, 0,
+		    work);
+    }
+
+    void KinematicTree::computeJacobian
+    (const std::vector <Transform3f>& positions, size_type rank,
+     JointJacobian_t& jacobian) const
+    {
+      for (size_type j = rank; j >= 0; j = nodes_ [j].parent) {
+	// Columns are written at the rank of the joint in the velocity
+	// vector: no workspace is needed.
+	writeColumns (nodes_ [j], positions [j], positions [rank], jacobian,
+		      nodes_ [j].rankInVelocity, jacobian);
+      }
+    }
+
+    void KinematicTree::computeJacobian
+    (const std::vector <Transform3f>& positions, size_type rank,
+     SparseJacobian& jacobian, JointJacobian_t& work) const
+    {
+      size_type size = 0;
+      for (size_type j = rank; j >= 0; j = nodes_ [j].parent) {
+	size += nodes_ [j].numberDof;
+      }
+      jacobian.numberDof_ = numberDof_;
+      jacobian.indices_.resize (size);
+      jacobian.values_.resize (6, size);
+      jacobian.values_.setZero ();
+      // Ancestors are visited from the joint to the root: fill columns from
+      // the last one.
+      size_type col = size;
+      for (size_type j = rank; j >= 0; j = nodes_ [j].parent) {
+	const Node_t& node (nodes_ [j]);
+	col -= node.numberDof;
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  jacobian.indices_ [col + k] = node.rankInVelocity + k;
+	}
+	writeColumns (node, positions [j], positions [rank], jacobian.values_,
+		      col, work);
+      }
+    }
+
+    void KinematicTree::computeVelocities
+    (const std::vector <Transform3f>& positions, vectorIn_t velocity,
+     std::vector <fcl::Vec3f>& linear, std::vector <fcl::Vec3f>& angular,
+     JointJacobian_t& work) const
+    {
+      linear.resize (nodes_.size ());
+      angular.resize (nodes_.size ());
+      for (std::size_t i = 0; i < nodes_.size (); ++i) {
+	const Node_t& node (nodes_ [i]);
+	const size_type col = node.rankInVelocity;
+	fcl::Vec3f& v (linear [i]);
+	fcl::Vec3f& w (angular [i]);
+	// Velocity of the point of the parent body at the joint origin
+	if (node.parent < 0) {
+	  v.setValue (0);
+	  w.setValue (0);
+	} else {
+	  const fcl::Vec3f& wp (angular [node.parent]);
+	  v = linear [node.parent] +
+	    wp.cross (positions [i].getTranslation () -
+		      positions [node.parent].getTranslation ());
+	  w = wp;
+	}
+	// Joint motion
+	const fcl::Matrix3f& R (positions [i].getRotation ());
+	switch (node.type) {
+	case JOINT_ANCHOR:
+	  break;
+	case JOINT_SO3:
+	  w += fcl::Vec3f (velocity [col], velocity [col+1], velocity [col+2]);
+	  break;
+	case JOINT_ROTATION_BOUNDED:
+	case JOINT_ROTATION_UNBOUNDED:
+	  w += R.getColumn (0) * velocity [col];
+	  break;
+	case JOINT_TRANSLATION_3:
+	  v += R.getColumn (2) * velocity [col+2];
+	  // fall through
+	case JOINT_TRANSLATION_2:
+	  v += R.getColumn (1) * velocity [col+1];
+	  // fall through
+	case JOINT_TRANSLATION_1:
+	  v += R.getColumn (0) * velocity [col];
+	  break;
+	default:
+	  {
+	    assert (work.cols () >= col + node.numberDof);
+	    work.middleCols (col, node.numberDof).setZero ();
+	    node.joint->writeSubJacobian (positions [i], positions [i], work);
+	    const vector6_t twist (work.middleCols (col, node.numberDof) *
+				   velocity.segment (col, node.numberDof));
+	    v += fcl::Vec3f (twist [0], twist [1], twist [2]);
+	    w += fcl::Vec3f (twist [3], twist [4], twist [5]);
+	  }
+	}
+      }
+    }
+
+    void KinematicTree::computeAccelerations
+    (const std::vector <Transform3f>& positions, vectorIn_t velocity,
+     vectorIn_t acceleration,
+     const std::vector <fcl::Vec3f>& linearVelocities,
+     const std::vector <fcl::Vec3f>& angularVelocities,
+     std::vector <fcl::Vec3f>& linear, std::vector <fcl::Vec3f>& angular,
+     JointJacobian_t& work) const
+    {
+      const bool drift = (acceleration.size () == 0);
+      linear.resize (nodes_.size ());
+      angular.resize (nodes_.size ());
+      for (std::size_t i = 0; i < nodes_.size (); ++i) {
+	const Node_t& node (nodes_ [i]);
+	const size_type col = node.rankInVelocity;
+	fcl::Vec3f& a (linear [i]);
+	fcl::Vec3f& alpha (angular [i]);
+	// Angular velocity of the parent joint
+	fcl::Vec3f wp (0, 0, 0);
+	if (node.parent < 0) {
+	  a.setValue (0);
+	  alpha.setValue (0);
+	} else {
+	  // Acceleration of the point of the parent body at the joint
+	  // origin
+	  wp = angularVelocities [node.parent];
+	  const fcl::Vec3f r (positions [i].getTranslation () -
+			      positions [node.parent].getTranslation ());
+	  a = linear [node.parent] + angular [node.parent].cross (r) +
+	    wp.cross (wp.cross (r));
+	  alpha = angular [node.parent];
+	}
+	// Joint motion: relative velocity is expressed in world frame and
+	// the motion subspace rotates with the parent joint.
+	fcl::Vec3f vRel (0, 0, 0), wRel (0, 0, 0), aRel (0, 0, 0),
+	  alphaRel (0, 0, 0);
+	const fcl::Matrix3f& R (positions [i].getRotation ());
+	switch (node.type) {
+	case JOINT_ANCHOR:
+	  break;
+	case JOINT_SO3:
+	  // The angular velocity is the joint velocity: its derivative is
+	  // the joint acceleration.
+	  if (!drift) {
+	    alpha += fcl::Vec3f (acceleration [col], acceleration [col+1],
+				 acceleration [col+2]);
+	  }
+	  break;
+	case JOINT_ROTATION_BOUNDED:
+	case JOINT_ROTATION_UNBOUNDED:
+	  wRel = R.getColumn (0) * velocity [col];
+	  if (!drift) alphaRel = R.getColumn (0) * acceleration [col];
+	  break;
+	case JOINT_TRANSLATION_3:
+	case JOINT_TRANSLATION_2:
+	case JOINT_TRANSLATION_1:
+	  for (size_type k = 0; k < node.numberDof; ++k) {
+	    vRel += R.getColumn (k) * velocity [col+k];
+	    if (!drift) aRel += R.getColumn (k) * acceleration [col+k];
+	  }
+	  break;
+	default:
+	  {
+	    assert (work.cols () >= col + node.numberDof);
+	    work.middleCols (col, node.numberDof).setZero ();
+	    node.joint->writeSubJacobian (positions [i], positions [i], work);
+	    const vector6_t twist (work.middleCols (col, node.numberDof) *
+				   velocity.segment (col, node.numberDof));
+	    vRel = fcl::Vec3f (twist [0], twist [1], twist [2]);
+	    wRel = fcl::Vec3f (twist [3], twist [4], twist [5]);
+	    if (!drift) {
+	      const vector6_t dtwist
+		(work.middleCols (col, node.numberDof) *
+		 acceleration.segment (col, node.numberDof));
+	      aRel = fcl::Vec3f (dtwist [0], dtwist [1], dtwist [2]);
+	      alphaRel = fcl::Vec3f (dtwist [3], dtwist [4], dtwist [5]);
+	    }
+	  }
+	}
+	a += aRel + wp.cross (vRel) * 2;
+	alpha += alphaRel + wp.cross (wRel);
+      }
+    }
+
+    void KinematicTree::writeComColumns (const Node_t& node,
+					 const Transform3f& position,
+					 const fcl::Vec3f& massCom,
+					 value_type mass, value_type totalMass,
+					 ComJacobian_t& jacobian)
+    {
+      if (node.type == JOINT_GENERIC) {
+	node.joint->writeComSubjacobian (position, massCom, totalMass,
+					 jacobian);
+	return;
+      }
+      if (mass <= 0) return;
+      const size_type col = node.rankInVelocity;
+      const fcl::Vec3f com (massCom * (1/mass));
+      const fcl::Matrix3f& R (position.getRotation ());
+      switch (node.type) {
+      case JOINT_SO3:
+	{
+	  const fcl::Vec3f x ((position.getTranslation () - com) *
+			      (mass/totalMass));
+	  jacobian (0, col+1) = -x [2]; jacobian (1, col) = x [2];
+	  jacobian (0, col+2) = x [1]; jacobian (2, col) = -x [1];
+	  jacobian (1, col+2) = -x [0]; jacobian (2, col+1) = x [0];
+	}
+	break;
+      case JOINT_ROTATION_BOUNDED:
+      case JOINT_ROTATION_UNBOUNDED:
+	{
+	  const fcl::Vec3f cross
+	    ((position.getTranslation () - com).cross (R.getColumn (0)) *
+	     (mass/totalMass));
+	  for (size_type r = 0; r < 3; ++r) jacobian (r, col) = cross [r];
+	}
+	break;
+      case JOINT_TRANSLATION_3:
+      case JOINT_TRANSLATION_2:
+      case JOINT_TRANSLATION_1:
+	for (size_type k = 0; k < node.numberDof; ++k) {
+	  for (size_type r = 0; r < 3; ++r) {
+	    jacobian (r, col+k) = (mass/totalMass) * R (r, k);
+	  }
+	}
+	break;
+      default:
+	break;
+      }
+    }
+  } // namespace model
+} // namespace hpp
@@ -0,0 +1,517 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <hpp/model/kinematics-generator.hh>
+#include <hpp/model/body.hh>
+#include <hpp/model/device.hh>
+#include <hpp/model/joint.hh>
+
+namespace hpp {
+  namespace model {
+    namespace {
+      /// Linear combination of variables of the generated code
+      ///
+      /// Coefficients within a few ulps of 0, 1 or -1 are folded.
+      class Expression
+      {
+      public:
+	Expression () : terms_ (), constant_ (0)
+	{
+	}
+	Expression& add (const std::string& variable, value_type coefficient)
+	{
+	  terms_.push_back (Term_t (variable, coefficient));
+	  return *this;
+	}
+	Expression& add (value_type constant)
+	{
+	  constant_ += constant;
+	  return *this;
+	}
+	/// Add coefficient * expression * variable
+	Expression& add (const Expression& expression,
+			 const std::string& variable,
+			 value_type coefficient = 1)
+	{
+	  for (std::size_t i = 0; i < expression.terms_.size (); ++i) {
+	    add (expression.terms_ [i].first + " * " + variable,
+		 coefficient * expression.terms_ [i].second);
+	  }
+	  return add (variable, coefficient * expression.constant_);
+	}
+	std::string str () const
+	{
+	  std::ostringstream os;
+	  bool empty = true;
+	  for (std::size_t i = 0; i < terms_.size (); ++i) {
+	    const value_type c = terms_ [i].second;
+	    if (isZero (c)) continue;
+	    if (isZero (c - 1)) {
+	      os << (empty ? "" : " + ");
+	    } else if (isZero (c + 1)) {
+	      os << (empty ? "-" : " - ");
+	    } else if (c < 0 && !empty) {
+	      os << " - " << constant (-c) << " * ";
+	    } else {
+	      os << (empty ? "" : " + ") << constant (c) << " * ";
+	    }
+	    os << terms_ [i].first;
+	    empty = false;
+	  }
+	  if (empty || !isZero (constant_)) {
+	    if (!empty && constant_ < 0) {
+	      os << " - " << constant (-constant_);
+	    } else {
+	      os << (empty ? "" : " + ") << constant (constant_);
+	    }
+	  }
+	  return os.str ();
+	}
+	static std::string constant (value_type value)
+	{
+	  std::ostringstream os;
+	  os.precision (std::numeric_limits <value_type>::digits10 + 2);
+	  if (isZero (value)) value = 0;
+	  else if (isZero (value - 1)) value = 1;
+	  else if (isZero (value + 1)) value = -1;
+	  os << "Scalar (" << value << ")";
+	  return os.str ();
+	}
+      private:
+	static bool isZero (value_type value)
+	{
+	  return fabs (value) <=
+	    8 * std::numeric_limits <value_type>::epsilon ();
+	}
+	typedef std::pair <std::string, value_type> Term_t;
+	std::vector <Term_t> terms_;
+	value_type constant_;
+      }; // class Expression
+
+      std::string element (const std::string& array, size_type index)
+      {
+	std::ostringstream os;
+	os << array << " [" << index << "]";
+	return os.str ();
+      }
+
+      std::string variable (const std::string& name, size_type index)
+      {
+	std::ostringstream os;
+	os << name << index;
+	return os.str ();
+      }
+
+      /// Index of coefficient (row, col) of the Jacobian of a joint
+      size_type index (size_type rank, size_type nbRows, size_type nbCols,
+		       size_type row, size_type col)
+      {
+	return nbRows * (nbCols * rank + col) + row;
+      }
+    } // namespace
+
+    KinematicsGeneratorPtr_t KinematicsGenerator::create
+    (const DeviceConstPtr_t& device)
+    {
+      return KinematicsGeneratorPtr_t (new KinematicsGenerator (device));
+    }
+
+    KinematicsGenerator::KinematicsGenerator (const DeviceConstPtr_t& device) :
+      device_ (device), className_ ("Kinematics"), namespaceName_ ()
+    {
+    }
+
+    void KinematicsGenerator::generate (std::ostream& os) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      if (tree.size () == 0) {
+	throw std::runtime_error ("Device " + device_->name () +
+				  " has no joint.");
+      }
+      for (size_type i = 0; i < tree.size (); ++i) {
+	if (tree [i].type == JOINT_GENERIC) {
+	  throw std::runtime_error ("Cannot generate code for joint " +
+				    tree [i].joint->name () + ".");
+	}
+      }
+      // Mass of each subtree
+      std::vector <value_type> masses (tree.size (), 0);
+      for (size_type i = 0; i < tree.size (); ++i) {
+	BodyPtr_t body = tree [i].joint->linkedBody ();
+	if (body) masses [i] = body->mass ();
+      }
+      for (size_type i = tree.size () - 1; i > 0; --i) {
+	masses [tree [i].parent] += masses [i];
+      }
+      // Header guard and namespaces
+      std::vector <std::string> namespaces;
+      std::string guard;
+      std::string::size_type begin = 0;
+      while (!namespaceName_.empty ()) {
+	std::string::size_type end = namespaceName_.find ("::", begin);
+	namespaces.push_back (namespaceName_.substr (begin, end - begin));
+	guard += namespaces.back () + "_";
+	if (end == std::string::npos) break;
+	begin = end + 2;
+      }
+      guard += className_ + "_HH";
+      for (std::size_t i = 0; i < guard.size (); ++i) {
+	const unsigned char c = guard [i];
+	guard [i] = isalnum (c) ? (char) toupper (c) : '_';
+      }
+
+      os << "// Generated by hpp::model::KinematicsGenerator from device "
+	 << device_->name () << "." << std::endl
+	 << "// Do not edit." << std::endl << std::endl
+	 << "#ifndef " << guard << std::endl
+	 << "# define " << guard << std::endl << std::endl
+	 << "# include <cmath>" << std::endl << std::endl;
+      for (std::size_t i = 0; i < namespaces.size (); ++i) {
+	os << "namespace " << namespaces [i] << " {" << std::endl;
+      }
+      os << "template <typename Scalar> struct " << className_ << std::endl
+	 << "{" << std::endl
+	 << "  enum {" << std::endl
+	 << "    configSize = " << device_->configSize () << "," << std::endl
+	 << "    numberDof = " << device_->numberDof () -
+	device_->extraConfigSpace ().dimension () << "," << std::endl
+	 << "    numberJoints = " << tree.size () << std::endl
+	 << "  };" << std::endl << std::endl;
+      writeForwardKinematics (os);
+      writeJacobians (os);
+      writeMassCenters (os, masses);
+      writeCenterOfMass (os, masses);
+      writeJacobianCenterOfMass (os, masses);
+      os << "}; // struct " << className_ << std::endl;
+      for (std::size_t i = namespaces.size (); i > 0; --i) {
+	os << "} // namespace " << namespaces [i-1] << std::endl;
+      }
+      os << "#endif // " << guard << std::endl;
+    }
+
+    void KinematicsGenerator::writeForwardKinematics (std::ostream& os) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      os << "  static void forwardKinematics (const Scalar* q, Scalar* M)"
+	 << std::endl << "  {" << std::endl
+	 << "    using std::cos;" << std::endl
+	 << "    using std::sin;" << std::endl;
+      for (size_type i = 0; i < tree.size (); ++i) {
+	const KinematicTree::Node_t& node (tree [i]);
+	const size_type b = 12*i;
+	const size_type rank = node.rankInConfiguration;
+	const fcl::Matrix3f& R (node.rotationInParent);
+	const fcl::Vec3f& T (node.translationInParent);
+	os << "    // Joint " << node.joint->name () << std::endl
+	   << "    {" << std::endl;
+	// a, t = parent position * position in parent frame. For the root
+	// joint, a and t are constant and folded into the expressions below.
+	std::vector <Expression> a (9), t (3);
+	for (size_type r = 0; r < 3; ++r) {
+	  for (size_type c = 0; c < 3; ++c) {
+	    if (node.parent < 0) {
+	      a [3*r+c].add (R (r, c));
+	      continue;
+	    }
+	    Expression e;
+	    for (size_type k = 0; k < 3; ++k) {
+	      e.add (element ("M", 12*node.parent + 3*r + k), R (k, c));
+	    }
+	    os << "      const Scalar a" << 3*r+c << " = " << e.str () << ";"
+	       << std::endl;
+	    a [3*r+c].add (variable ("a", 3*r+c), 1);
+	  }
+	}
+	for (size_type r = 0; r < 3; ++r) {
+	  if (node.parent < 0) {
+	    t [r].add (T [r]);
+	    continue;
+	  }
+	  Expression e;
+	  e.add (element ("M", 12*node.parent + 9 + r), 1);
+	  for (size_type k = 0; k < 3; ++k) {
+	    e.add (element ("M", 12*node.parent + 3*r + k), T [k]);
+	  }
+	  os << "      const Scalar t" << r << " = " << e.str () << ";"
+	     << std::endl;
+	  t [r].add (variable ("t", r), 1);
+	}
+	// Joint motion
+	std::vector <Expression> M (12);
+	switch (node.type) {
+	case JOINT_ANCHOR:
+	case JOINT_TRANSLATION_1:
+	case JOINT_TRANSLATION_2:
+	case JOINT_TRANSLATION_3:
+	  for (size_type k = 0; k < 9; ++k) M [k] = a [k];
+	  for (size_type r = 0; r < 3; ++r) {
+	    M [9+r] = t [r];
+	    for (size_type k = 0; k < node.configSize; ++k) {
+	      M [9+r].add (a [3*r+k], element ("q", rank+k));
+	    }
+	  }
+	  break;
+	case JOINT_ROTATION_BOUNDED:
+	case JOINT_ROTATION_UNBOUNDED:
+	  if (node.type == JOINT_ROTATION_BOUNDED) {
+	    os << "      const Scalar c = cos (q [" << rank << "]), "
+	       << "s = sin (q [" << rank << "]);" << std::endl;
+	  } else {
+	    os << "      const Scalar c = q [" << rank << "], "
+	       << "s = q [" << rank+1 << "];" << std::endl;
+	  }
+	  for (size_type r = 0; r < 3; ++r) {
+	    M [3*r] = a [3*r];
+	    M [3*r+1].add (a [3*r+1], "c").add (a [3*r+2], "s");
+	    M [3*r+2].add (a [3*r+2], "c").add (a [3*r+1], "s", -1);
+	    M [9+r] = t [r];
+	  }
+	  break;
+	case JOINT_SO3:
+	  os << "      const Scalar w = q [" << rank << "], x = q [" << rank+1
+	     << "], y = q [" << rank+2 << "], z = q [" << rank+3 << "];"
+	     << std::endl
+	     << "      const Scalar q0 = 1 - 2*(y*y + z*z), q1 = 2*(x*y - z*w),"
+	     << " q2 = 2*(x*z + y*w);" << std::endl
+	     << "      const Scalar q3 = 2*(x*y + z*w), q4 = 1 - 2*(x*x + z*z),"
+	     << " q5 = 2*(y*z - x*w);" << std::endl
+	     << "      const Scalar q6 = 2*(x*z - y*w), q7 = 2*(y*z + x*w),"
+	     << " q8 = 1 - 2*(x*x + y*y);" << std::endl;
+	  for (size_type r = 0; r < 3; ++r) {
+	    for (size_type c = 0; c < 3; ++c) {
+	      for (size_type k = 0; k < 3; ++k) {
+		M [3*r+c].add (a [3*r+k], variable ("q", 3*k+c));
+	      }
+	    }
+	    M [9+r] = t [r];
+	  }
+	  break;
+	default:
+	  assert (false && "Unknown joint type.");
+	}
+	for (size_type k = 0; k < 12; ++k) {
+	  os << "      M [" << b+k << "] = " << M [k].str () << ";"
+	     << std::endl;
+	}
+	os << "    }" << std::endl;
+      }
+      os << "  }" << std::endl << std::endl;
+    }
+
+    void KinematicsGenerator::writeJacobians (std::ostream& os) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      const size_type nv = device_->numberDof () -
+	device_->extraConfigSpace ().dimension ();
+      os << "  static void jacobians (const Scalar* M, Scalar* J)" << std::endl
+	 << "  {" << std::endl
+	 << "    for (int i = 0; i < " << 6*nv*tree.size ()
+	 << "; ++i) J [i] = 0;" << std::endl;
+      for (size_type i = 0; i < tree.size (); ++i) {
+	os << "    // Joint " << tree [i].joint->name () << std::endl;
+	// Only ancestors of a joint contribute to its Jacobian.
+	for (size_type j = i; j >= 0; j = tree [j].parent) {
+	  const KinematicTree::Node_t& node (tree [j]);
+	  const size_type col = node.rankInVelocity;
+	  const size_type b = 12*j;
+	  switch (node.type) {
+	  case JOINT_ANCHOR:
+	    break;
+	  case JOINT_ROTATION_BOUNDED:
+	  case JOINT_ROTATION_UNBOUNDED:
+	    if (j != i) {
+	      // (O_j - O_i) x axis_j
+	      os << "    {" << std::endl;
+	      for (size_type r = 0; r < 3; ++r) {
+		os << "      const Scalar d" << r << " = M [" << b+9+r
+		   << "] - M [" << 12*i+9+r << "];" << std::endl;
+	      }
+	      for (size_type r = 0; r < 3; ++r) {
+		const size_type r1 = (r+1)%3, r2 = (r+2)%3;
+		os << "      J [" << index (i, 6, nv, r, col) << "] = d" << r1
+		   << " * M [" << b+3*r2 << "] - d" << r2 << " * M ["
+		   << b+3*r1 << "];" << std::endl;
+	      }
+	      os << "    }" << std::endl;
+	    }
+	    for (size_type r = 0; r < 3; ++r) {
+	      os << "    J [" << index (i, 6, nv, 3+r, col) << "] = M ["
+		 << b+3*r << "];" << std::endl;
+	    }
+	    break;
+	  case JOINT_TRANSLATION_1:
+	  case JOINT_TRANSLATION_2:
+	  case JOINT_TRANSLATION_3:
+	    for (size_type k = 0; k < node.numberDof; ++k) {
+	      for (size_type r = 0; r < 3; ++r) {
+		os << "    J [" << index (i, 6, nv, r, col+k) << "] = M ["
+		   << b+3*r+k << "];" << std::endl;
+	      }
+	    }
+	    break;
+	  case JOINT_SO3:
+	    for (size_type r = 0; r < 3; ++r) {
+	      os << "    J [" << index (i, 6, nv, 3+r, col+r) << "] = 1;"
+		 << std::endl;
+	    }
+	    if (j != i) {
+	      // Cross product matrix of O_j - O_i
+	      for (size_type r = 0; r < 3; ++r) {
+		const size_type r1 = (r+1)%3, r2 = (r+2)%3;
+		os << "    J [" << index (i, 6, nv, r1, col+r) << "] = M ["
+		   << b+9+r2 << "] - M [" << 12*i+9+r2 << "];" << std::endl
+		   << "    J [" << index (i, 6, nv, r2, col+r) << "] = M ["
+		   << 12*i+9+r1 << "] - M [" << b+9+r1 << "];" << std::endl;
+	      }
+	    }
+	    break;
+	  default:
+	    assert (false && "Unknown joint type.");
+	  }
+	}
+      }
+      os << "  }" << std::endl << std::endl;
+    }
+
+    void KinematicsGenerator::writeMassCenters
+    (std::ostream& os, const std::vector <value_type>& masses) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      os << "  static void massCenters (const Scalar* M, Scalar* mc)"
+	 << std::endl << "  {" << std::endl;
+      for (size_type i = 0; i < tree.size (); ++i) {
+	BodyPtr_t body = tree [i].joint->linkedBody ();
+	const value_type m = body ? body->mass () : 0;
+	for (size_type r = 0; r < 3; ++r) {
+	  Expression e;
+	  if (m != 0) {
+	    const fcl::Vec3f& com (body->localCenterOfMass ());
+	    e.add (element ("M", 12*i+9+r), m);
+	    for (size_type k = 0; k < 3; ++k) {
+	      e.add (element ("M", 12*i+3*r+k), m * com [k]);
+	    }
+	  }
+	  os << "    mc [" << 3*i+r << "] = " << e.str () << ";" << std::endl;
+	}
+      }
+      // Accumulate from the leaves
+      for (size_type i = tree.size () - 1; i > 0; --i) {
+	if (masses [i] == 0) continue;
+	for (size_type r = 0; r < 3; ++r) {
+	  os << "    mc [" << 3*tree [i].parent+r << "] += mc [" << 3*i+r
+	     << "];" << std::endl;
+	}
+      }
+      os << "  }" << std::endl << std::endl;
+    }
+
+    void KinematicsGenerator::writeCenterOfMass
+    (std::ostream& os, const std::vector <value_type>& masses) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      os << "  static void centerOfMass (const Scalar* M, Scalar* com)"
+	 << std::endl << "  {" << std::endl;
+      if (masses [0] == 0) {
+	os << "    com [0] = com [1] = com [2] = 0;" << std::endl;
+      } else {
+	os << "    Scalar mc [" << 3*tree.size () << "];" << std::endl
+	   << "    massCenters (M, mc);" << std::endl;
+	for (size_type r = 0; r < 3; ++r) {
+	  os << "    com [" << r << "] = "
+	     << Expression ().add (element ("mc", r), 1/masses [0]).str ()
+	     << ";" << std::endl;
+	}
+      }
+      os << "  }" << std::endl << std::endl;
+    }
+
+    void KinematicsGenerator::writeJacobianCenterOfMass
+    (std::ostream& os, const std::vector <value_type>& masses) const
+    {
+      const KinematicTree& tree (device_->kinematicTree ());
+      const size_type nv = device_->numberDof () -
+	device_->extraConfigSpace ().dimension ();
+      const value_type totalMass = masses [0];
+      os << "  static void jacobianCenterOfMass (const Scalar* M, Scalar* J)"
+	 << std::endl << "  {" << std::endl
+	 << "    for (int i = 0; i < " << 3*nv << "; ++i) J [i] = 0;"
+	 << std::endl;
+      if (totalMass != 0) {
+	os << "    Scalar mc [" << 3*tree.size () << "];" << std::endl
+	   << "    massCenters (M, mc);" << std::endl;
+      }
+      for (size_type j = 0; j < tree.size (); ++j) {
+	const KinematicTree::Node_t& node (tree [j]);
+	if (masses [j] == 0 || node.type == JOINT_ANCHOR) continue;
+	const size_type col = node.rankInVelocity;
+	const size_type b = 12*j;
+	const value_type ratio = masses [j] / totalMass;
+	os << "    // Joint " << node.joint->name () << std::endl;
+	switch (node.type) {
+	case JOINT_ROTATION_BOUNDED:
+	case JOINT_ROTATION_UNBOUNDED:
+	case JOINT_SO3:
+	  // v = m_j / m * (O_j - com_j)
+	  os << "    {" << std::endl;
+	  for (size_type r = 0; r < 3; ++r) {
+	    os << "      const Scalar v" << r << " = " << Expression ().
+	      add (element ("M", b+9+r), ratio).
+	      add (element ("mc", 3*j+r), -1/totalMass).str () << ";"
+	       << std::endl;
+	  }
+	  for (size_type r = 0; r < 3; ++r) {
+	    const size_type r1 = (r+1)%3, r2 = (r+2)%3;
+	    if (node.type == JOINT_SO3) {
+	      os << "      J [" << index (0, 3, nv, r1, col+r) << "] = v" << r2
+		 << ";" << std::endl
+		 << "      J [" << index (0, 3, nv, r2, col+r) << "] = -v" << r1
+		 << ";" << std::endl;
+	    } else {
+	      os << "      J [" << index (0, 3, nv, r, col) << "] = v" << r1
+		 << " * M [" << b+3*r2 << "] - v" << r2 << " * M ["
+		 << b+3*r1 << "];" << std::endl;
+	    }
+	  }
+	  os << "    }" << std::endl;
+	  break;
+	case JOINT_TRANSLATION_1:
+	case JOINT_TRANSLATION_2:
+	case JOINT_TRANSLATION_3:
+	  for (size_type k = 0; k < node.numberDof; ++k) {
+	    for (size_type r = 0; r < 3; ++r) {
+	      os << "    J [" << index (0, 3, nv, r, col+k) << "] = "
+		 << Expression ().add (element ("M", b+3*r+k), ratio).str ()
+		 << ";" << std::endl;
+	    }
+	  }
+	  break;
+	default:
+	  assert (false && "Unknown joint type.");
+	}
+      }
+      os << "  }" << std::endl;
+    }
+  } // namespace model
+} // namespace hpp
@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include <hpp/model/parallel-collision-test.hh>
+#include <hpp/model/device-data.hh>
+
+namespace hpp {
+  namespace model {
+    ParallelCollisionTestPtr_t ParallelCollisionTest::create
+    (const DeviceConstPtr_t& device, size_type numberThreads)
+    {
+      return ParallelCollisionTestPtr_t
+	(new ParallelCollisionTest (device, numberThreads));
+    }
+
+    ParallelCollisionTest::ParallelCollisionTest
+    (const DeviceConstPtr_t& device, size_type numberThreads) :
+      device_ (device), tests_ (), testsVersion_ (-1), threads_ (),
+      mutex_ (), start_ (), done_ (), data_ (0x0), generation_ (0),
+      running_ (0), stop_ (false), numberPairs_ (0), numberCulled_ (0),
+      next_ (0), collision_ (false)
+    {
+      if (numberThreads <= 0) {
+	numberThreads = boost::thread::hardware_concurrency ();
+      }
+      // The thread calling compute also tests pairs.
+      for (size_type i = 1; i < numberThreads; ++i) {
+	threads_.push_back (new boost::thread
+			    (&ParallelCollisionTest::work, this));
+      }
+    }
+
+    ParallelCollisionTest::~ParallelCollisionTest ()
+    {
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	stop_ = true;
+      }
+      start_.notify_all ();
+      for (std::size_t i = 0; i < threads_.size (); ++i) {
+	threads_ [i]->join ();
+	delete threads_ [i];
+      }
+    }
+
+    bool ParallelCollisionTest::compute (const DeviceData& data)
+    {
+      if (testsVersion_ != device_->collisionObjectsVersion_) {
+	device_->computeCollisionTests (tests_);
+	testsVersion_ = device_->collisionObjectsVersion_;
+      }
+      {
+	boost::mutex::scoped_lock lock (mutex_);
+	data_ = &data;
+	next_ = 0;
+	collision_ = false;
+	numberPairs_ = numberCulled_ = 0;
+	running_ = threads_.size ();
+	++generation_;
+      }
+      start_.notify_all ();
+      size_type numberPairs = 0, numberCulled = 0;
+      testPairs (numberPairs, numberCulled);
+      boost::mutex::scoped_lock lock (mutex_);
+      while (running_ > 0) done_.wait (lock);
+      data.numberCollisionPairs_ += numberPairs_ + numberPairs;
+      data.numberCulledPairs_ += numberCulled_ + numberCulled;
+      data_ = 0x0;
+      return collision_;
+    }
+
+    void ParallelCollisionTest::work ()
+    {
+      std::size_t generation = 0;
+      while (true) {
+	{
+	  boost::mutex::scoped_lock lock (mutex_);
+	  while (!stop_ && generation_ == generation) start_.wait (lock);
+	  if (stop_) return;
+	  generation = generation_;
+	}
+	size_type numberPairs = 0, numberCulled = 0;
+	testPairs (numberPairs, numberCulled);
+	boost::mutex::scoped_lock lock (mutex_);
+	numberPairs_ += numberPairs;
+	numberCulled_ += numberCulled;
+	if (--running_ == 0) done_.notify_one ();
+      }
+    }
+
+    void ParallelCollisionTest::testPairs (size_type& numberPairs,
+					   size_type& numberCulled)
+    {
+      // Each pair is tested by the thread that takes its index. Threads
+      // stop as soon as one of them finds a collision: the result is true
+      // if and only if a pair is in collision.
+      while (!collision_.load (boost::memory_order_acquire)) {
+	const std::size_t i = next_.fetch_add (1, boost::memory_order_relaxed);
+	if (i >= tests_.size ()) return;
+	if (device_->collisionTest (*data_, tests_ [i], numberPairs,
+				    numberCulled)) {
+	  collision_.store (true, boost::memory_order_release);
+	  return;
+	}
+      }
+    }
+  } // namespace model
+} // namespace hpp
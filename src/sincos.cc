@@ -0,0 +1,187 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include <cmath>
+#if defined __AVX512F__ || defined __AVX2__
+# include <immintrin.h>
+#endif
+#include "sincos.hh"
+
+namespace hpp {
+  namespace model {
+    namespace {
+      // Angles are reduced to [-pi/4, pi/4] by subtracting a multiple of
+      // pi/2 split in three parts (Cody-Waite reduction), then sine and
+      // cosine are approximated by the polynomials of the Cephes library.
+      const value_type twoOverPi = 0.63661977236758134308;
+      const value_type piOver2_1 = 1.57079625129699707031;
+      const value_type piOver2_2 = 7.54978941586159635335e-8;
+      const value_type piOver2_3 = 5.39030285815811905290e-15;
+      const value_type s0 = 1.58962301576546568060e-10;
+      const value_type s1 = -2.50507477628578072866e-8;
+      const value_type s2 = 2.75573136213857245213e-6;
+      const value_type s3 = -1.98412698295895385996e-4;
+      const value_type s4 = 8.33333333332211858878e-3;
+      const value_type s5 = -1.66666666666666307295e-1;
+      const value_type c0 = -1.13585365213876817300e-11;
+      const value_type c1 = 2.08757008419747316778e-9;
+      const value_type c2 = -2.75573141792967388112e-7;
+      const value_type c3 = 2.48015872888517045348e-5;
+      const value_type c4 = -1.38888888888730564116e-3;
+      const value_type c5 = 4.16666666666665929218e-2;
+
+      void sinCosScalar (value_type angle, value_type& sine,
+			 value_type& cosine)
+      {
+	const value_type y = std::floor (angle * twoOverPi + .5);
+	const value_type r = ((angle - y * piOver2_1) - y * piOver2_2) -
+	  y * piOver2_3;
+	const value_type z = r * r;
+	const value_type sr = r + r * z *
+	  (((((s0 * z + s1) * z + s2) * z + s3) * z + s4) * z + s5);
+	const value_type cr = 1 - .5 * z + z * z *
+	  (((((c0 * z + c1) * z + c2) * z + c3) * z + c4) * z + c5);
+	// Quadrant of the angle
+	const value_type q = y - 4 * std::floor (.25 * y);
+	const bool swap = (q == 1 || q == 3);
+	sine = swap ? cr : sr;
+	cosine = swap ? sr : cr;
+	if (q >= 2) sine = -sine;
+	if (q == 1 || q == 2) cosine = -cosine;
+      }
+
+#if defined __AVX512F__
+      const size_type width = 8;
+
+      void sinCosPacket (const value_type* angle, value_type* sine,
+			 value_type* cosine)
+      {
+	typedef __m512d Packet_t;
+	const Packet_t x = _mm512_loadu_pd (angle);
+	const Packet_t y = _mm512_roundscale_pd
+	  (_mm512_mul_pd (x, _mm512_set1_pd (twoOverPi)),
+	   _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	Packet_t r = _mm512_sub_pd (x, _mm512_mul_pd
+				    (y, _mm512_set1_pd (piOver2_1)));
+	r = _mm512_sub_pd (r, _mm512_mul_pd (y, _mm512_set1_pd (piOver2_2)));
+	r = _mm512_sub_pd (r, _mm512_mul_pd (y, _mm512_set1_pd (piOver2_3)));
+	const Packet_t z = _mm512_mul_pd (r, r);
+	Packet_t ps = _mm512_set1_pd (s0), pc = _mm512_set1_pd (c0);
+	const value_type sc [] = {s1, s2, s3, s4, s5};
+	const value_type cc [] = {c1, c2, c3, c4, c5};
+	for (int k = 0; k < 5; ++k) {
+	  ps = _mm512_add_pd (_mm512_mul_pd (ps, z), _mm512_set1_pd (sc [k]));
+	  pc = _mm512_add_pd (_mm512_mul_pd (pc, z), _mm512_set1_pd (cc [k]));
+	}
+	const Packet_t sr = _mm512_add_pd
+	  (r, _mm512_mul_pd (_mm512_mul_pd (r, z), ps));
+	const Packet_t cr = _mm512_add_pd
+	  (_mm512_sub_pd (_mm512_set1_pd (1),
+			  _mm512_mul_pd (_mm512_set1_pd (.5), z)),
+	   _mm512_mul_pd (_mm512_mul_pd (z, z), pc));
+	// Quadrant of the angle
+	const Packet_t q = _mm512_sub_pd
+	  (y, _mm512_mul_pd (_mm512_set1_pd (4), _mm512_roundscale_pd
+			     (_mm512_mul_pd (_mm512_set1_pd (.25), y),
+			      _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)));
+	const __mmask8 q1 = _mm512_cmp_pd_mask (q, _mm512_set1_pd (1),
+						_CMP_EQ_OQ);
+	const __mmask8 q2 = _mm512_cmp_pd_mask (q, _mm512_set1_pd (2),
+						_CMP_EQ_OQ);
+	const __mmask8 q3 = _mm512_cmp_pd_mask (q, _mm512_set1_pd (3),
+						_CMP_EQ_OQ);
+	const __mmask8 swap = q1 | q3;
+	const Packet_t zero = _mm512_setzero_pd ();
+	Packet_t s = _mm512_mask_blend_pd (swap, sr, cr);
+	Packet_t c = _mm512_mask_blend_pd (swap, cr, sr);
+	s = _mm512_mask_sub_pd (s, q2 | q3, zero, s);
+	c = _mm512_mask_sub_pd (c, q1 | q2, zero, c);
+	_mm512_storeu_pd (sine, s);
+	_mm512_storeu_pd (cosine, c);
+      }
+#elif defined __AVX2__
+      const size_type width = 4;
+
+      void sinCosPacket (const value_type* angle, value_type* sine,
+			 value_type* cosine)
+      {
+	typedef __m256d Packet_t;
+	const Packet_t x = _mm256_loadu_pd (angle);
+	const Packet_t y = _mm256_round_pd
+	  (_mm256_mul_pd (x, _mm256_set1_pd (twoOverPi)),
+	   _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	Packet_t r = _mm256_sub_pd (x, _mm256_mul_pd
+				    (y, _mm256_set1_pd (piOver2_1)));
+	r = _mm256_sub_pd (r, _mm256_mul_pd (y, _mm256_set1_pd (piOver2_2)));
+	r = _mm256_sub_pd (r, _mm256_mul_pd (y, _mm256_set1_pd (piOver2_3)));
+	const Packet_t z = _mm256_mul_pd (r, r);
+	Packet_t ps = _mm256_set1_pd (s0), pc = _mm256_set1_pd (c0);
+	const value_type sc [] = {s1, s2, s3, s4, s5};
+	const value_type cc [] = {c1, c2, c3, c4, c5};
+	for (int k = 0; k < 5; ++k) {
+	  ps = _mm256_add_pd (_mm256_mul_pd (ps, z), _mm256_set1_pd (sc [k]));
+	  pc = _mm256_add_pd (_mm256_mul_pd (pc, z), _mm256_set1_pd (cc [k]));
+	}
+	const Packet_t sr = _mm256_add_pd
+	  (r, _mm256_mul_pd (_mm256_mul_pd (r, z), ps));
+	const Packet_t cr = _mm256_add_pd
+	  (_mm256_sub_pd (_mm256_set1_pd (1),
+			  _mm256_mul_pd (_mm256_set1_pd (.5), z)),
+	   _mm256_mul_pd (_mm256_mul_pd (z, z), pc));
+	// Quadrant of the angle
+	const Packet_t q = _mm256_sub_pd
+	  (y, _mm256_mul_pd (_mm256_set1_pd (4), _mm256_floor_pd
+			     (_mm256_mul_pd (_mm256_set1_pd (.25), y))));
+	const Packet_t q1 = _mm256_cmp_pd (q, _mm256_set1_pd (1), _CMP_EQ_OQ);
+	const Packet_t q2 = _mm256_cmp_pd (q, _mm256_set1_pd (2), _CMP_EQ_OQ);
+	const Packet_t q3 = _mm256_cmp_pd (q, _mm256_set1_pd (3), _CMP_EQ_OQ);
+	const Packet_t swap = _mm256_or_pd (q1, q3);
+	// Sign bits to flip
+	const Packet_t signBit = _mm256_set1_pd (-0.);
+	const Packet_t s = _mm256_blendv_pd (sr, cr, swap);
+	const Packet_t c = _mm256_blendv_pd (cr, sr, swap);
+	_mm256_storeu_pd (sine, _mm256_xor_pd
+			  (s, _mm256_and_pd (signBit, _mm256_or_pd (q2, q3))));
+	_mm256_storeu_pd (cosine, _mm256_xor_pd
+			  (c, _mm256_and_pd (signBit, _mm256_or_pd (q1, q2))));
+      }
+#else
+      const size_type width = 1;
+
+      void sinCosPacket (const value_type* angle, value_type* sine,
+			 value_type* cosine)
+      {
+	sinCosScalar (*angle, *sine, *cosine);
+      }
+#endif
+    } // namespace
+
+    void sinCos (size_type n, const value_type* angles, value_type* sines,
+		 value_type* cosines)
+    {
+      size_type i = 0;
+      for (; i + width <= n; i += width) {
+	sinCosPacket (angles + i, sines + i, cosines + i);
+      }
+      for (; i < n; ++i) {
+	sinCosScalar (angles [i], sines [i], cosines [i]);
+      }
+    }
+  } // namespace model
+} // namespace hpp
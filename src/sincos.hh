@@ -0,0 +1,41 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#ifndef HPP_MODEL_SRC_SINCOS_HH
+# define HPP_MODEL_SRC_SINCOS_HH
+
+# include <hpp/model/fwd.hh>
+
+namespace hpp {
+  namespace model {
+    /// Compute sine and cosine of an array of angles
+    /// \param n number of angles,
+    /// \param angles array of n angles,
+    /// \retval sines, cosines arrays of n values.
+    ///
+    /// Angles are processed by 8 with AVX-512 and by 4 with AVX2 when the
+    /// library is compiled for these instruction sets, one by one
+    /// otherwise. All implementations use the same polynomial
+    /// approximation, accurate to about one ulp for angles of moderate
+    /// magnitude.
+    void sinCos (size_type n, const value_type* angles, value_type* sines,
+		 value_type* cosines);
+  } // namespace model
+} // namespace hpp
+#endif // HPP_MODEL_SRC_SINCOS_HH
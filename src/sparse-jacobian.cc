@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2016 CNRS
+//
+//
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+
+#include <cassert>
+#include <hpp/model/sparse-jacobian.hh>
+
+namespace hpp {
+  namespace model {
+    SparseJacobian::SparseJacobian () : numberDof_ (0), indices_ (),
+					values_ (6, 0)
+    {
+    }
+
+    void SparseJacobian::multiply (vectorIn_t velocity, vector6_t& result)
+      const
+    {
+      assert (velocity.size () == numberDof_);
+      result.setZero ();
+      for (std::size_t i = 0; i < indices_.size (); ++i) {
+	result += values_.col (i) * velocity [indices_ [i]];
+      }
+    }
+
+    void SparseJacobian::transposeMultiply (const vector6_t& wrench,
+					    vectorOut_t result) const
+    {
+      assert (result.size () == numberDof_);
+      result.setZero ();
+      for (std::size_t i = 0; i < indices_.size (); ++i) {
+	result [indices_ [i]] = values_.col (i).dot (wrench);
+      }
+    }
+
+    void SparseJacobian::toDense (JointJacobian_t& jacobian) const
+    {
+      jacobian.resize (6, numberDof_);
+      jacobian.setZero ();
+      for (std::size_t i = 0; i < indices_.size (); ++i) {
+	jacobian.col (indices_ [i]) = values_.col (i);
+      }
+    }
+  } // namespace model
+} // namespace hpp
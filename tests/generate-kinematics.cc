@@ -0,0 +1,40 @@
+///
+/// Copyright (c) 2016 CNRS
+///
+///
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+// Write the kinematics of the robot of test-generated-kinematics into the
+// file given as argument.
+
+#include <fstream>
+#include <iostream>
+#include <hpp/model/kinematics-generator.hh>
+#include "generated-kinematics-robot.hh"
+
+int main (int argc, char** argv)
+{
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv [0] << " output-file" << std::endl;
+    return 1;
+  }
+  hpp::model::KinematicsGeneratorPtr_t generator =
+    hpp::model::KinematicsGenerator::create (createRobot ());
+  generator->className ("RobotKinematics");
+  generator->namespaceName ("hpp::model::test");
+  std::ofstream file (argv [1]);
+  generator->generate (file);
+  return file ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+///
+/// Copyright (c) 2016 CNRS
+///
+///
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+#ifndef HPP_MODEL_TESTS_GENERATED_KINEMATICS_ROBOT_HH
+# define HPP_MODEL_TESTS_GENERATED_KINEMATICS_ROBOT_HH
+
+// Robot shared by generate-kinematics and test-generated-kinematics
+
+# include <hpp/model/body.hh>
+# include <hpp/model/device.hh>
+# include <hpp/model/object-factory.hh>
+
+// Create a robot with all types of joints supported by KinematicsGenerator
+inline hpp::model::DevicePtr_t createRobot ()
+{
+  using hpp::model::BodyPtr_t;
+  using hpp::model::DevicePtr_t;
+  using hpp::model::JointPtr_t;
+  using hpp::model::JointVector_t;
+  using hpp::model::ObjectFactory;
+  using hpp::model::Transform3f;
+  using hpp::model::size_type;
+  using fcl::Quaternion3f;
+
+  DevicePtr_t robot = hpp::model::Device::create ("robot");
+  Transform3f position; position.setIdentity ();
+  ObjectFactory factory;
+
+  JointPtr_t root = factory.createJointTranslation3 (position);
+  root->name ("root");
+  robot->rootJoint (root);
+  for (size_type i=0; i<3; ++i) {
+    root->isBounded (i, true);
+    root->lowerBound (i, -1);
+    root->upperBound (i, 1);
+  }
+  JointPtr_t so3 = factory.createJointSO3 (position);
+  so3->name ("so3");
+  root->addChildJoint (so3);
+  // First branch: rotations about y and z, translation
+  position.setQuatRotation (Quaternion3f (sqrt (2)/2, 0, 0, sqrt (2)/2));
+  position.setTranslation (fcl::Vec3f (.1, .2, .3));
+  JointPtr_t j1 = factory.createBoundedJointRotation (position);
+  j1->name ("j1");
+  so3->addChildJoint (j1);
+  position.setQuatRotation (Quaternion3f (sqrt (2)/2, 0, -sqrt (2)/2, 0));
+  position.setTranslation (fcl::Vec3f (.5, 0, 0));
+  JointPtr_t j2 = factory.createUnBoundedJointRotation (position);
+  j2->name ("j2");
+  j1->addChildJoint (j2);
+  position.setTranslation (fcl::Vec3f (.5, .1, 0));
+  JointPtr_t j3 = factory.createJointTranslation (position);
+  j3->name ("j3");
+  j2->addChildJoint (j3);
+  j3->isBounded (0, true);
+  j3->lowerBound (0, -.2);
+  j3->upperBound (0, .2);
+  // Second branch: anchor, rotation and planar translation
+  position.setQuatRotation (Quaternion3f (.5, .5, .5, .5));
+  position.setTranslation (fcl::Vec3f (-.1, -.2, .3));
+  JointPtr_t j4 = factory.createJointAnchor (position);
+  j4->name ("j4");
+  so3->addChildJoint (j4);
+  position.setTranslation (fcl::Vec3f (-.4, -.2, .3));
+  JointPtr_t j5 = factory.createBoundedJointRotation (position);
+  j5->name ("j5");
+  j4->addChildJoint (j5);
+  position.setTranslation (fcl::Vec3f (-.4, -.2, .1));
+  JointPtr_t j6 = factory.createJointTranslation2 (position);
+  j6->name ("j6");
+  j5->addChildJoint (j6);
+  for (size_type i=0; i<2; ++i) {
+    j6->isBounded (i, true);
+    j6->lowerBound (i, -.5);
+    j6->upperBound (i, .5);
+  }
+  // Attach a body to each joint but the anchor
+  const JointVector_t& jv = robot->getJointVector ();
+  for (std::size_t i=0; i<jv.size (); ++i) {
+    if (jv [i] == j4) continue;
+    BodyPtr_t body = factory.createBody ();
+    body->name (jv [i]->name () + "_body");
+    body->mass (1 + .1 * i);
+    body->localCenterOfMass (fcl::Vec3f (.1 * i, -.05, .02));
+    jv [i]->setLinkedBody (body);
+  }
+  return robot;
+}
+
+#endif // HPP_MODEL_TESTS_GENERATED_KINEMATICS_ROBOT_HH
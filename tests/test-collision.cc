@@ -0,0 +1,628 @@
+///
+/// Copyright (c) 2016 CNRS
+///
+///
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+// This test
+//   - builds a planar arm with boxes attached to the joints and a few
+//     box obstacles,
+//   - randomly samples configurations,
+//   - checks that collision tests and distance computations performed on
+//     a DeviceData give the same results as the same computations
+//     performed on the device,
+//   - checks that collision objects are placed at the position of the
+//     joints,
+//   - checks that collision tests of a batch of configurations give the
+//     same results as collision tests of each configuration,
+//   - checks that a robot built in bulk construction mode is the same as
+//     a robot built joint by joint,
+//   - checks that pairs of distant objects are rejected by bounding
+//     spheres,
+//   - checks that collision tests of the device and of the bodies using the
+//     obstacle tree of the device give the same results as tests of each
+//     pair of objects,
+//   - checks that collision tests and distance computations of the bodies
+//     place objects after forward kinematics with default computation
+//     flag,
+//   - checks that adaptive ordering of collision tests gives the same
+//     results as the default order and is deterministic,
+//   - checks that collision tests on several threads give the same
+//     results as collision tests on one thread, with box and mesh
+//     obstacles.
+
+#include <sstream>
+
+#define BOOST_TEST_MODULE TEST_COLLISION
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/fcl/collision.h>
+#include <hpp/fcl/BVH/BVH_model.h>
+#include <hpp/fcl/shape/geometric_shapes.h>
+#include <hpp/util/debug.hh>
+#include <hpp/model/batch-collision-test.hh>
+#include <hpp/model/body.hh>
+#include <hpp/model/collision-object.hh>
+#include <hpp/model/configuration.hh>
+#include <hpp/model/device-data.hh>
+#include <hpp/model/distance-result.hh>
+#include <hpp/model/object-factory.hh>
+#include <hpp/model/parallel-collision-test.hh>
+
+using hpp::model::BatchCollisionTest;
+using hpp::model::BatchCollisionTestPtr_t;
+using hpp::model::BodyPtr_t;
+using hpp::model::CollisionObject;
+using hpp::model::CollisionObjectPtr_t;
+using hpp::model::Configuration_t;
+using hpp::model::Device;
+using hpp::model::DeviceData;
+using hpp::model::DeviceDataPtr_t;
+using hpp::model::DevicePtr_t;
+using hpp::model::DistanceResults_t;
+using hpp::model::JointPtr_t;
+using hpp::model::JointVector_t;
+using hpp::model::ObjectFactory;
+using hpp::model::ObjectVector_t;
+using hpp::model::ParallelCollisionTest;
+using hpp::model::ParallelCollisionTestPtr_t;
+using hpp::model::matrix_t;
+using hpp::model::Transform3f;
+using hpp::model::size_type;
+using hpp::model::value_type;
+
+// Attach a box to a joint in initial position
+void addBox (const JointPtr_t& joint, const fcl::Vec3f& translation)
+{
+  ObjectFactory factory;
+  BodyPtr_t body = factory.createBody ();
+  body->name (joint->name () + "_body");
+  joint->setLinkedBody (body);
+  fcl::CollisionGeometryPtr_t box (new fcl::Box (.6, .2, .2));
+  Transform3f position (joint->currentTransformation ());
+  position.setTranslation (position.transform (translation));
+  CollisionObjectPtr_t object = CollisionObject::create
+    (box, position, joint->name () + "_box");
+  body->addInnerObject (object, true, true);
+}
+
+// Create a triangle mesh of a cube
+fcl::CollisionGeometryPtr_t createMeshCube (value_type size)
+{
+  std::vector <fcl::Vec3f> vertices;
+  for (int i=0; i<8; ++i) {
+    vertices.push_back (fcl::Vec3f ((i & 1) ? size/2 : -size/2,
+				    (i & 2) ? size/2 : -size/2,
+				    (i & 4) ? size/2 : -size/2));
+  }
+  const int faces [12][3] = {{0, 4, 6}, {0, 6, 2}, {1, 3, 7}, {1, 7, 5},
+			     {0, 1, 5}, {0, 5, 4}, {2, 6, 7}, {2, 7, 3},
+			     {0, 2, 3}, {0, 3, 1}, {4, 5, 7}, {4, 7, 6}};
+  std::vector <fcl::Triangle> triangles;
+  for (std::size_t i=0; i<12; ++i) {
+    triangles.push_back (fcl::Triangle (faces [i][0], faces [i][1],
+					faces [i][2]));
+  }
+  fcl::BVHModel <fcl::OBBRSS>* mesh = new fcl::BVHModel <fcl::OBBRSS> ();
+  mesh->beginModel ();
+  mesh->addSubModel (vertices, triangles);
+  mesh->endModel ();
+  return fcl::CollisionGeometryPtr_t (mesh);
+}
+
+// Create a planar arm with a mobile base and a few obstacles
+// \param bulk whether the robot is built in bulk construction mode,
+// \param meshes whether obstacles are triangle meshes instead of boxes.
+DevicePtr_t createRobot (std::vector <CollisionObjectPtr_t>& obstacles,
+			 bool bulk = false, bool meshes = false)
+{
+  DevicePtr_t robot = Device::create ("arm");
+  if (bulk) robot->beginBulkConstruction ();
+  Transform3f position; position.setIdentity ();
+  ObjectFactory factory;
+
+  JointPtr_t base = factory.createJointTranslation2 (position);
+  base->name ("base");
+  robot->rootJoint (base);
+  for (size_type i=0; i<2; ++i) {
+    base->isBounded (i, true);
+    base->lowerBound (i, -2);
+    base->upperBound (i, 2);
+  }
+  // Rotations about z-axis
+  position.setQuatRotation (fcl::Quaternion3f (sqrt (2)/2, 0, -sqrt (2)/2,
+					       0));
+  JointPtr_t parent = base;
+  for (size_type i=0; i<4; ++i) {
+    position.setTranslation (fcl::Vec3f (.7 * i, 0, 0));
+    JointPtr_t joint = factory.createBoundedJointRotation (position);
+    std::ostringstream name; name << "joint" << i;
+    joint->name (name.str ());
+    parent->addChildJoint (joint);
+    parent = joint;
+  }
+  const JointVector_t& jv = robot->getJointVector ();
+  for (std::size_t i=1; i<jv.size (); ++i) {
+    addBox (jv [i], fcl::Vec3f (0, 0, .35));
+  }
+  // Auto-collision between first and last boxes
+  robot->addCollisionPairs (jv [1], jv [4], hpp::model::COLLISION);
+  robot->addCollisionPairs (jv [1], jv [4], hpp::model::DISTANCE);
+  // Obstacles. Bodies identify objects by their geometry: each obstacle
+  // has its own.
+  for (size_type i=0; i<5; ++i) {
+    fcl::CollisionGeometryPtr_t box (meshes ? createMeshCube (.4) :
+				     fcl::CollisionGeometryPtr_t
+				     (new fcl::Box (.4, .4, .4)));
+    position.setIdentity ();
+    position.setTranslation (fcl::Vec3f (-2 + i, 1.5 - .8 * i, 0));
+    std::ostringstream name; name << "obstacle" << i;
+    CollisionObjectPtr_t obstacle = CollisionObject::create
+      (box, position, name.str ());
+    obstacles.push_back (obstacle);
+    for (std::size_t j=1; j<jv.size (); ++j) {
+      jv [j]->linkedBody ()->addOuterObject (obstacle, true, true);
+    }
+  }
+  if (bulk) robot->endBulkConstruction ();
+  return robot;
+}
+
+void shootRandomConfig (const DevicePtr_t& robot, Configuration_t& config)
+{
+  JointVector_t jv = robot->getJointVector ();
+  for (JointVector_t::const_iterator itJoint = jv.begin ();
+       itJoint != jv.end (); itJoint++) {
+    std::size_t rank = (*itJoint)->rankInConfiguration ();
+    (*itJoint)->configuration ()->uniformlySample (rank, config);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (device_data)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  DistanceResults_t distances;
+  size_type nbCollisions = 0;
+  for (size_type n=0; n<1000; ++n) {
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    bool collision = robot->collisionTest (*data);
+    robot->computeDistances (*data, distances);
+
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    BOOST_CHECK (collision == robot->collisionTest ());
+    robot->computeDistances ();
+    const DistanceResults_t& reference (robot->distanceResults ());
+    BOOST_CHECK (distances.size () == reference.size ());
+    for (std::size_t i=0; i<distances.size (); ++i) {
+      BOOST_CHECK (distances [i].innerObject == reference [i].innerObject);
+      BOOST_CHECK (distances [i].outerObject == reference [i].outerObject);
+      BOOST_CHECK (fabs (distances [i].distance () -
+			 reference [i].distance ()) < 1e-10);
+    }
+    if (collision) ++nbCollisions;
+  }
+  // Make sure that both colliding and collision-free configurations are
+  // tested.
+  BOOST_CHECK (nbCollisions > 0);
+  BOOST_CHECK (nbCollisions < 1000);
+}
+
+// Check that fcl objects attached to the joints are at the position of the
+// joints
+bool objectsPlaced (const DevicePtr_t& robot)
+{
+  const JointVector_t& jv = robot->getJointVector ();
+  for (std::size_t i=1; i<jv.size (); ++i) {
+    const CollisionObjectPtr_t& object
+      (jv [i]->linkedBody ()->innerObjects (hpp::model::COLLISION).front ());
+    Transform3f expected (jv [i]->currentTransformation () *
+			  object->positionInJointFrame ());
+    if ((object->getTransform ().getTranslation () -
+	 expected.getTranslation ()).length () > 1e-10) {
+      return false;
+    }
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE (placement)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    if (n % 2 == 0) {
+      // Objects are placed by forward kinematics.
+      robot->controlComputation (Device::GEOMETRY);
+      robot->computeForwardKinematics ();
+    } else {
+      // Objects are placed on demand.
+      robot->controlComputation (Device::JOINT_POSITION);
+      robot->computeForwardKinematics ();
+      robot->updateGeometry ();
+    }
+    BOOST_CHECK (objectsPlaced (robot));
+  }
+  // Placement by forward kinematics is opt-in.
+  std::vector <CollisionObjectPtr_t> otherObstacles;
+  DevicePtr_t other = createRobot (otherObstacles);
+  BOOST_CHECK (!(other->computationFlag () & Device::GEOMETRY));
+}
+
+BOOST_AUTO_TEST_CASE (batch)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  const size_type N = 1000;
+  matrix_t configurations (N, robot->configSize ());
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<N; ++n) {
+    shootRandomConfig (robot, q);
+    configurations.row (n) = q.transpose ();
+  }
+  BatchCollisionTestPtr_t batch = BatchCollisionTest::create (robot);
+  std::vector <bool> collisions;
+  batch->compute (configurations, collisions);
+  BOOST_CHECK (collisions.size () == (std::size_t) N);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  for (size_type n=0; n<N; ++n) {
+    data->currentConfiguration (configurations.row (n).transpose ());
+    robot->computeForwardKinematics (*data);
+    BOOST_CHECK (collisions [n] == robot->collisionTest (*data));
+  }
+  // Some configurations should be filtered by bounding spheres.
+  BOOST_CHECK (batch->numberConfirmed () < N);
+}
+
+BOOST_AUTO_TEST_CASE (bulk_construction)
+{
+  std::vector <CollisionObjectPtr_t> obstacles, bulkObstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  DevicePtr_t bulk = createRobot (bulkObstacles, true);
+  BOOST_CHECK (!bulk->inBulkConstruction ());
+  BOOST_CHECK (bulk->configSize () == robot->configSize ());
+  BOOST_CHECK (bulk->numberDof () == robot->numberDof ());
+  BOOST_CHECK (bulk->kinematicTree ().size () ==
+	       robot->kinematicTree ().size ());
+  BOOST_CHECK (bulk->currentConfiguration () ==
+	       robot->currentConfiguration ());
+  BOOST_CHECK (bulk->mass () == robot->mass ());
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    bulk->currentConfiguration (q);
+    bulk->computeForwardKinematics ();
+    BOOST_CHECK (bulk->collisionTest () == robot->collisionTest ());
+    robot->computeDistances ();
+    bulk->computeDistances ();
+    BOOST_CHECK (bulk->distanceResults ().size () ==
+		 robot->distanceResults ().size ());
+  }
+  BOOST_CHECK_THROW (bulk->endBulkConstruction (), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE (culling)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  BOOST_CHECK (data->numberCollisionPairs () == 0);
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    robot->collisionTest (*data);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    robot->collisionTest ();
+  }
+  // Most obstacles are far from the arm.
+  BOOST_CHECK (data->numberCulledPairs () > 0);
+  BOOST_CHECK (data->numberCulledPairs () <= data->numberCollisionPairs ());
+  BOOST_CHECK (robot->data ().numberCollisionPairs () ==
+	       data->numberCollisionPairs ());
+  BOOST_CHECK (robot->data ().numberCulledPairs () ==
+	       data->numberCulledPairs ());
+  data->resetCollisionStatistics ();
+  BOOST_CHECK (data->numberCollisionPairs () == 0);
+  BOOST_CHECK (data->numberCulledPairs () == 0);
+}
+
+// Test each pair of objects of the bodies with fcl::collide, objects being
+// placed.
+bool collisionTestPairs (const DevicePtr_t& robot)
+{
+  robot->updateGeometry ();
+  fcl::CollisionRequest request;
+  fcl::CollisionResult result;
+  const JointVector_t& jv = robot->getJointVector ();
+  for (std::size_t i=0; i<jv.size (); ++i) {
+    BodyPtr_t body = jv [i]->linkedBody ();
+    if (!body) continue;
+    const ObjectVector_t& inner (body->innerObjects (hpp::model::COLLISION));
+    const ObjectVector_t& outer (body->outerObjects (hpp::model::COLLISION));
+    for (ObjectVector_t::const_iterator itInner = inner.begin ();
+	 itInner != inner.end (); ++itInner) {
+      for (ObjectVector_t::const_iterator itOuter = outer.begin ();
+	   itOuter != outer.end (); ++itOuter) {
+	result.clear ();
+	if (fcl::collide ((*itInner)->fcl ().get (),
+			  (*itOuter)->fcl ().get (), request, result) != 0) {
+	  return true;
+	}
+      }
+    }
+  }
+  return false;
+}
+
+// Collision tests of the bodies
+bool collisionTestBodies (const DevicePtr_t& robot)
+{
+  const JointVector_t& jv = robot->getJointVector ();
+  for (std::size_t i=0; i<jv.size (); ++i) {
+    BodyPtr_t body = jv [i]->linkedBody ();
+    if (body && body->collisionTest ()) return true;
+  }
+  return false;
+}
+
+BOOST_AUTO_TEST_CASE (obstacle_tree)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  const JointVector_t& jv = robot->getJointVector ();
+  BOOST_CHECK (robot->obstacles (hpp::model::COLLISION).size () ==
+	       obstacles.size ());
+  robot->controlComputation (Device::GEOMETRY);
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    BOOST_CHECK (robot->collisionTest () == collisionTestPairs (robot));
+    BOOST_CHECK (collisionTestBodies (robot) == collisionTestPairs (robot));
+  }
+  // Remove an obstacle from some bodies only, then from all bodies.
+  jv [1]->linkedBody ()->removeOuterObject (obstacles [0], true, false);
+  BOOST_CHECK (robot->obstacles (hpp::model::COLLISION).size () ==
+	       obstacles.size ());
+  for (std::size_t j=2; j<jv.size (); ++j) {
+    jv [j]->linkedBody ()->removeOuterObject (obstacles [0], true, false);
+  }
+  BOOST_CHECK (robot->obstacles (hpp::model::COLLISION).size () ==
+	       obstacles.size () - 1);
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    BOOST_CHECK (robot->collisionTest () == collisionTestPairs (robot));
+    BOOST_CHECK (collisionTestBodies (robot) == collisionTestPairs (robot));
+  }
+  // Move an obstacle onto the first box: the obstacle tree is updated
+  // by CollisionObject::move.
+  const Transform3f& box (jv [1]->linkedBody ()->innerObjects
+			  (hpp::model::COLLISION).front ()->getTransform ());
+  obstacles [1]->move (box);
+  BOOST_CHECK (robot->collisionTest ());
+  BOOST_CHECK (collisionTestPairs (robot));
+  BOOST_CHECK (collisionTestBodies (robot));
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  data->currentConfiguration (q);
+  robot->computeForwardKinematics (*data);
+  BOOST_CHECK (robot->collisionTest (*data));
+  // Move it away.
+  Transform3f position;
+  position.setTranslation (fcl::Vec3f (0, 0, 100));
+  obstacles [1]->move (position);
+  BOOST_CHECK (robot->collisionTest () == collisionTestPairs (robot));
+  BOOST_CHECK (robot->collisionTest (*data) == collisionTestPairs (robot));
+  BOOST_CHECK (collisionTestBodies (robot) == collisionTestPairs (robot));
+  // A copy of the device has its own obstacle tree, also updated when an
+  // obstacle moves.
+  {
+    DevicePtr_t copy = robot->clone ();
+    BOOST_CHECK (copy->obstacles (hpp::model::COLLISION).size () ==
+		 robot->obstacles (hpp::model::COLLISION).size ());
+    obstacles [1]->move (box);
+    BOOST_CHECK (robot->collisionTest ());
+    BOOST_CHECK (copy->collisionTest ());
+    obstacles [1]->move (position);
+    BOOST_CHECK (copy->collisionTest () == robot->collisionTest ());
+  }
+  BOOST_CHECK (robot->obstacles (hpp::model::COLLISION).size () ==
+	       obstacles.size () - 1);
+  BOOST_CHECK (robot->collisionTest () == collisionTestPairs (robot));
+  // Replace and delete the body of the last joint: the device does not
+  // refer to the deleted body anymore.
+  BodyPtr_t removed = jv [4]->linkedBody ();
+  addBox (jv [4], fcl::Vec3f (0, 0, .35));
+  delete removed;
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    BOOST_CHECK (robot->collisionTest () == collisionTestPairs (robot));
+  }
+}
+
+BOOST_AUTO_TEST_CASE (body_placement)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  DistanceResults_t distances, bodyDistances;
+  size_type nbCollisions = 0;
+  // Forward kinematics with default computation flag does not place
+  // objects.
+  BOOST_CHECK (!(robot->computationFlag () & Device::GEOMETRY));
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    const bool collision = robot->collisionTest (*data);
+    robot->computeDistances (*data, distances);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    bool bodyCollision = false;
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      BodyPtr_t body = jv [i]->linkedBody ();
+      if (body && body->collisionTest ()) bodyCollision = true;
+    }
+    BOOST_CHECK (bodyCollision == collision);
+    BOOST_CHECK (objectsPlaced (robot));
+    // Move the arm so that objects are placed again by the bodies.
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    robot->computeDistances (*data, distances);
+    bodyDistances.resize (distances.size ());
+    DistanceResults_t::size_type offset = 0;
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      BodyPtr_t body = jv [i]->linkedBody ();
+      if (body) body->computeDistances (bodyDistances, offset);
+    }
+    BOOST_CHECK (offset == distances.size ());
+    for (std::size_t i=0; i<distances.size (); ++i) {
+      BOOST_CHECK (fabs (distances [i].distance () -
+			 bodyDistances [i].distance ()) < 1e-10);
+    }
+    if (collision) ++nbCollisions;
+  }
+  BOOST_CHECK (nbCollisions > 0);
+}
+
+BOOST_AUTO_TEST_CASE (adaptive_order)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  DeviceDataPtr_t adaptive1 = DeviceData::create (robot);
+  DeviceDataPtr_t adaptive2 = DeviceData::create (robot);
+  adaptive1->adaptiveCollisionOrder (true);
+  adaptive2->adaptiveCollisionOrder (true);
+  BOOST_CHECK (!data->adaptiveCollisionOrder ());
+  BOOST_CHECK (adaptive1->adaptiveCollisionOrder ());
+  Configuration_t q (robot->configSize ());
+  Configuration_t qCollision (robot->configSize ());
+  bool collision = false;
+  for (size_type n=0; n<200; ++n) {
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    adaptive1->currentConfiguration (q);
+    robot->computeForwardKinematics (*adaptive1);
+    adaptive2->currentConfiguration (q);
+    robot->computeForwardKinematics (*adaptive2);
+    const bool result = robot->collisionTest (*data);
+    BOOST_CHECK (robot->collisionTest (*adaptive1) == result);
+    BOOST_CHECK (robot->collisionTest (*adaptive2) == result);
+    if (result && !collision) {
+      collision = true;
+      qCollision = q;
+    }
+    if (n == 100) {
+      // Modifying the collision objects resets the order.
+      robot->getJointVector () [1]->linkedBody ()->removeOuterObject
+	(obstacles [0], true, false);
+    }
+  }
+  // Same tests in the same order.
+  BOOST_CHECK (adaptive1->numberCollisionPairs () ==
+	       adaptive2->numberCollisionPairs ());
+  BOOST_CHECK (adaptive1->numberCulledPairs () ==
+	       adaptive2->numberCulledPairs ());
+  // After a collision, the colliding pair is tested first.
+  BOOST_REQUIRE (collision);
+  data->currentConfiguration (qCollision);
+  robot->computeForwardKinematics (*data);
+  adaptive1->currentConfiguration (qCollision);
+  robot->computeForwardKinematics (*adaptive1);
+  BOOST_CHECK (robot->collisionTest (*adaptive1));
+  data->resetCollisionStatistics ();
+  adaptive1->resetCollisionStatistics ();
+  BOOST_CHECK (robot->collisionTest (*data));
+  BOOST_CHECK (robot->collisionTest (*adaptive1));
+  BOOST_CHECK (adaptive1->numberCollisionPairs () <=
+	       data->numberCollisionPairs ());
+  // Disabling the mode restores the default order.
+  adaptive1->adaptiveCollisionOrder (false);
+  adaptive1->resetCollisionStatistics ();
+  BOOST_CHECK (robot->collisionTest (*adaptive1));
+  BOOST_CHECK (adaptive1->numberCollisionPairs () ==
+	       data->numberCollisionPairs ());
+}
+
+// Compare parallel collision tests with collision tests on one thread
+// \param meshes whether obstacles are triangle meshes.
+void checkParallelCollisionTest (bool meshes)
+{
+  std::vector <CollisionObjectPtr_t> obstacles;
+  DevicePtr_t robot = createRobot (obstacles, false, meshes);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  const size_type numberThreads [] = {1, 2, 4};
+  for (std::size_t t=0; t<3; ++t) {
+    ParallelCollisionTestPtr_t parallel
+      (ParallelCollisionTest::create (robot, numberThreads [t]));
+    BOOST_CHECK (parallel->numberThreads () == numberThreads [t]);
+    size_type numberCollisions = 0;
+    for (size_type n=0; n<200; ++n) {
+      shootRandomConfig (robot, q);
+      data->currentConfiguration (q);
+      robot->computeForwardKinematics (*data);
+      data->resetCollisionStatistics ();
+      const bool result = robot->collisionTest (*data);
+      const size_type numberPairs = data->numberCollisionPairs ();
+      data->resetCollisionStatistics ();
+      BOOST_CHECK (parallel->compute (*data) == result);
+      if (result) {
+	++numberCollisions;
+      } else {
+	// Without collision, all pairs are tested.
+	BOOST_CHECK (data->numberCollisionPairs () == numberPairs);
+      }
+      if (n == 100) {
+	// Pairs are read again when collision objects change.
+	robot->getJointVector () [1]->linkedBody ()->removeOuterObject
+	  (obstacles [t], true, false);
+      }
+    }
+    BOOST_CHECK (numberCollisions > 0);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (parallel_collision_test)
+{
+  checkParallelCollisionTest (false);
+  // Threads test the same meshes: the obstacle tree should be queried
+  // without modifying the geometries.
+  checkParallelCollisionTest (true);
+}
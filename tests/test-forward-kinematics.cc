@@ -0,0 +1,995 @@
+///
+/// Copyright (c) 2016 CNRS
+///
+///
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+// This test
+//   - builds a robot with various types of joints,
+//   - randomly samples configurations,
+//   - checks that the alternative forward kinematics algorithms give the
+//     same joint positions as Device::computeForwardKinematics,
+//   - checks that Jacobians computed from the kinematic tree are identical
+//     to Jacobians written by Joint::writeSubJacobian, also for joints
+//     handled through their virtual methods,
+//   - checks the vectorized sine and cosine used by forward kinematics
+//     against std::sin and std::cos,
+//   - checks that incremental forward kinematics gives the same joint
+//     positions and Jacobians as forward kinematics computed from scratch,
+//   - checks that forward kinematics computed in separate DeviceData
+//     instances gives the same results as forward kinematics of the device,
+//   - checks that quantities computed on demand are the same as quantities
+//     computed with joint positions,
+//   - checks that forward kinematics restricted to some joints gives the
+//     same positions as complete forward kinematics,
+//   - checks that sparse Jacobians are equal to dense Jacobians, also for
+//     joints handled through their virtual methods,
+//   - checks that joint velocities are equal to Jacobians times velocity,
+//     also for joints handled through their virtual methods,
+//   - checks joint accelerations and derivatives of Jacobians against
+//     finite differences, and against the same robot with joints handled
+//     through their virtual methods,
+//   - checks Jacobians of frames attached to joints against finite
+//     differences,
+//   - checks the center of mass of subsets of bodies computed from the
+//     device and from a DeviceData,
+//   - checks the centroidal momentum against the momenta of the bodies and
+//     its derivative against finite differences,
+//   - checks the power of the joint torques computed by inverse dynamics
+//     against the derivative of the mechanical energy,
+//   - checks the mass matrix and its factorization against inverse
+//     dynamics and kinetic energy, also for joints handled through their
+//     virtual methods,
+//   - checks forward dynamics against inverse dynamics.
+
+#define BOOST_TEST_MODULE TEST_FORWARD_KINEMATICS
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/batch-forward-kinematics.hh>
+#include <hpp/model/body.hh>
+#include <hpp/model/center-of-mass-computation.hh>
+#include <hpp/model/configuration.hh>
+#include <hpp/model/device-data.hh>
+#include <hpp/model/dynamics.hh>
+#include <hpp/model/joint.hh>
+#include <hpp/model/joint-configuration.hh>
+#include <hpp/model/object-factory.hh>
+#include <hpp/model/sparse-jacobian.hh>
+#include "../src/sincos.hh"
+
+using hpp::model::BatchForwardKinematics;
+using hpp::model::BodyPtr_t;
+using hpp::model::CenterOfMassComputation;
+using hpp::model::CenterOfMassComputationPtr_t;
+using hpp::model::BatchForwardKinematicsPtr_t;
+using hpp::model::ConfigurationIn_t;
+using hpp::model::Configuration_t;
+using hpp::model::JointPtr_t;
+using hpp::model::ObjectFactory;
+using hpp::model::Transform3f;
+using fcl::Quaternion3f;
+using hpp::model::Device;
+using hpp::model::DevicePtr_t;
+using hpp::model::DeviceData;
+using hpp::model::DeviceDataPtr_t;
+using hpp::model::Dynamics;
+using hpp::model::DynamicsPtr_t;
+using hpp::model::JointJacobian_t;
+using hpp::model::JointVector_t;
+using hpp::model::SparseJacobian;
+using hpp::model::matrix_t;
+using hpp::model::size_type;
+using hpp::model::value_type;
+using hpp::model::vector_t;
+using hpp::model::vectorIn_t;
+using hpp::model::vector6_t;
+
+// Rotation joint handled by the kinematic tree as a joint of type
+// JOINT_GENERIC, through its virtual methods
+class GenericRotation : public hpp::model::JointRotation
+{
+public:
+  GenericRotation (const Transform3f& initialPosition) :
+    JointRotation (initialPosition, 1, 1)
+  {
+    configuration_ = new hpp::model::rotationJointConfig::Bounded;
+  }
+  virtual JointPtr_t clone () const
+  {
+    return new GenericRotation (*this);
+  }
+  virtual void computePosition (ConfigurationIn_t configuration,
+				const Transform3f& parentPosition,
+				Transform3f& position) const
+  {
+    const value_type angle = configuration [rankInConfiguration ()];
+    fcl::Matrix3f R;
+    R.setIdentity ();
+    R (1,1) = cos (angle); R (1,2) = -sin (angle);
+    R (2,1) = sin (angle); R (2,2) = cos (angle);
+    Transform3f T3f;
+    T3f.setRotation (R);
+    position = parentPosition * positionInParentFrame_ * T3f;
+  }
+}; // class GenericRotation
+
+// Create a robot with various types of joints
+// \param generic whether bounded rotation joints are replaced by instances
+//        of GenericRotation.
+DevicePtr_t createRobot (bool generic = false)
+{
+  DevicePtr_t robot = Device::create ("robot");
+  Transform3f position; position.setIdentity ();
+  ObjectFactory factory;
+
+  // Free-flyer root joint
+  JointPtr_t root = factory.createJointTranslation3 (position);
+  robot->rootJoint (root);
+  for (size_type i=0; i<3; ++i) {
+    root->isBounded (i, true);
+    root->lowerBound (i, -1);
+    root->upperBound (i, 1);
+  }
+  JointPtr_t so3 = factory.createJointSO3 (position);
+  root->addChildJoint (so3);
+  // First branch: rotation about y and z, translation
+  position.setQuatRotation (Quaternion3f (sqrt (2)/2, 0, 0, sqrt (2)/2));
+  position.setTranslation (fcl::Vec3f (.1, .2, .3));
+  JointPtr_t j1 = generic ? new GenericRotation (position) :
+    factory.createBoundedJointRotation (position);
+  so3->addChildJoint (j1);
+  position.setQuatRotation (Quaternion3f (sqrt (2)/2, 0, -sqrt (2)/2, 0));
+  position.setTranslation (fcl::Vec3f (.5, 0, 0));
+  JointPtr_t j2 = factory.createUnBoundedJointRotation (position);
+  j1->addChildJoint (j2);
+  position.setTranslation (fcl::Vec3f (.5, .1, 0));
+  JointPtr_t j3 = factory.createJointTranslation (position);
+  j2->addChildJoint (j3);
+  j3->isBounded (0, true);
+  j3->lowerBound (0, -.2);
+  j3->upperBound (0, .2);
+  // Second branch: anchor and rotation
+  position.setQuatRotation (Quaternion3f (sqrt (2)/2, sqrt (2)/2, 0, 0));
+  position.setTranslation (fcl::Vec3f (-.1, -.2, .3));
+  JointPtr_t j4 = factory.createJointAnchor (position);
+  so3->addChildJoint (j4);
+  position.setTranslation (fcl::Vec3f (-.4, -.2, .3));
+  JointPtr_t j5 = generic ? new GenericRotation (position) :
+    factory.createBoundedJointRotation (position);
+  j4->addChildJoint (j5);
+  position.setTranslation (fcl::Vec3f (-.4, -.2, .1));
+  JointPtr_t j6 = factory.createJointTranslation2 (position);
+  j5->addChildJoint (j6);
+  for (size_type i=0; i<2; ++i) {
+    j6->isBounded (i, true);
+    j6->lowerBound (i, -.5);
+    j6->upperBound (i, .5);
+  }
+  // Attach a body to each joint
+  const JointVector_t& jv = robot->getJointVector ();
+  for (std::size_t i=0; i<jv.size (); ++i) {
+    BodyPtr_t body = factory.createBody ();
+    body->name (jv [i]->name () + "_body");
+    body->mass (1 + .1 * i);
+    body->localCenterOfMass (fcl::Vec3f (.1 * i, -.05, .02));
+    body->inertiaMatrix (hpp::model::matrix3_t (.02 + .01 * i, .001, -.002,
+						 .001, .03, .003,
+						 -.002, .003, .01 * (i + 1)));
+    jv [i]->setLinkedBody (body);
+  }
+  return robot;
+}
+
+void shootRandomConfig (const DevicePtr_t& robot, Configuration_t& config)
+{
+  JointVector_t jv = robot->getJointVector ();
+  for (JointVector_t::const_iterator itJoint = jv.begin ();
+       itJoint != jv.end (); itJoint++) {
+    std::size_t rank = (*itJoint)->rankInConfiguration ();
+    (*itJoint)->configuration ()->uniformlySample (rank, config);
+  }
+}
+
+bool isApprox (const Transform3f& M1, const Transform3f& M2,
+	       value_type eps = 1e-10)
+{
+  for (size_type i=0; i<3; ++i) {
+    for (size_type j=0; j<3; ++j) {
+      if (fabs (M1.getRotation () (i, j) - M2.getRotation () (i, j)) > eps)
+	return false;
+    }
+    if (fabs (M1.getTranslation () [i] - M2.getTranslation () [i]) > eps)
+      return false;
+  }
+  return true;
+}
+
+BOOST_AUTO_TEST_CASE (batch)
+{
+  DevicePtr_t robot = createRobot ();
+  const size_type N = 100;
+  matrix_t configurations (N, robot->configSize ());
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<N; ++n) {
+    shootRandomConfig (robot, q);
+    configurations.row (n) = q.transpose ();
+  }
+  BatchForwardKinematicsPtr_t batch = BatchForwardKinematics::create (robot);
+  BatchForwardKinematics::PlacementBatch_t placements;
+  batch->compute (configurations, placements);
+  BatchForwardKinematics::PlacementBatchf_t placementsf;
+  batch->compute (configurations, placementsf);
+
+  const JointVector_t& jv = robot->getJointVector ();
+  for (size_type n=0; n<N; ++n) {
+    robot->currentConfiguration (configurations.row (n).transpose ());
+    robot->computeForwardKinematics ();
+    for (JointVector_t::const_iterator it = jv.begin (); it != jv.end ();
+	 ++it) {
+      Transform3f M = BatchForwardKinematics::placement
+	(placements, batch->rank (*it), n);
+      BOOST_CHECK (isApprox (M, (*it)->currentTransformation ()));
+      M = BatchForwardKinematics::placement (placementsf, batch->rank (*it), n);
+      BOOST_CHECK (isApprox (M, (*it)->currentTransformation (), 1e-5));
+    }
+  }
+}
+
+// Compute joint positions by recursively calling Joint::computePosition
+void computeReferencePositions (const JointPtr_t& joint,
+				const Configuration_t& q,
+				const Transform3f& parentPosition,
+				std::vector <Transform3f>& positions)
+{
+  Transform3f& position (positions [joint->rankInTree ()]);
+  joint->computePosition (q, parentPosition, position);
+  for (std::size_t i=0; i<joint->numberChildJoints (); ++i) {
+    computeReferencePositions (joint->childJoint (i), q, position, positions);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (kinematic_tree)
+{
+  DevicePtr_t robot = createRobot ();
+  const hpp::model::KinematicTree& tree (robot->kinematicTree ());
+  BOOST_CHECK (tree.size () == (size_type) robot->getJointVector ().size ());
+  for (size_type i=0; i<tree.size (); ++i) {
+    BOOST_CHECK (tree [i].joint->rankInTree () == i);
+    BOOST_CHECK (tree [i].parent < i);
+    BOOST_CHECK (tree [i].subtreeEnd > i);
+    BOOST_CHECK (tree [i].subtreeEnd <= tree.size ());
+    for (size_type j=i+1; j<tree [i].subtreeEnd; ++j) {
+      BOOST_CHECK (tree [j].parent >= i);
+    }
+  }
+  Configuration_t q (robot->configSize ());
+  std::vector <Transform3f> positions (tree.size ());
+  Transform3f identity; identity.setIdentity ();
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    computeReferencePositions (robot->rootJoint (), q, identity, positions);
+    for (size_type i=0; i<tree.size (); ++i) {
+      BOOST_CHECK (isApprox (positions [i],
+			     tree [i].joint->currentTransformation ()));
+    }
+  }
+}
+
+// Compare Jacobians of the kinematic tree with Jacobians written by
+// Joint::writeSubJacobian for each ancestor of each joint.
+void checkTreeJacobians (const DevicePtr_t& robot)
+{
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  JointJacobian_t reference;
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      const JointJacobian_t& J (data->jacobian (jv [i]));
+      reference.resize (J.rows (), J.cols ());
+      reference.setZero ();
+      for (JointPtr_t ancestor = jv [i]; ancestor;
+	   ancestor = ancestor->parentJoint ()) {
+	ancestor->writeSubJacobian (data->position (ancestor),
+				    data->position (jv [i]), reference);
+	const size_type col = ancestor->rankInVelocity ();
+	const size_type size = ancestor->numberDof ();
+	BOOST_CHECK (J.middleCols (col, size) ==
+		     reference.middleCols (col, size));
+      }
+      BOOST_CHECK (J == reference);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (tree_jacobian)
+{
+  checkTreeJacobians (createRobot ());
+  checkTreeJacobians (createRobot (true));
+}
+
+// Compare sinCos with std::sin and std::cos for arrays of the given length
+bool checkSinCos (const std::vector <value_type>& angles)
+{
+  const std::size_t n = angles.size ();
+  std::vector <value_type> sines (n), cosines (n);
+  hpp::model::sinCos (n, &angles [0], &sines [0], &cosines [0]);
+  bool success = true;
+  for (std::size_t i=0; i<n; ++i) {
+    if (fabs (sines [i] - std::sin (angles [i])) > 1e-15 ||
+	fabs (cosines [i] - std::cos (angles [i])) > 1e-15) {
+      BOOST_TEST_MESSAGE ("sinCos failed for angle " << angles [i]);
+      success = false;
+    }
+  }
+  return success;
+}
+
+BOOST_AUTO_TEST_CASE (sin_cos)
+{
+  // Lengths exercising packets of 8 and 4 angles and the scalar tail
+  const std::size_t lengths [] = {1, 3, 7, 8, 9, 64, 65};
+  for (std::size_t l=0; l<7; ++l) {
+    std::vector <value_type> angles (lengths [l]);
+    // Angles of moderate magnitude, of both signs
+    for (std::size_t i=0; i<angles.size (); ++i) {
+      angles [i] = 20 * (rand () / (value_type) RAND_MAX - .5);
+    }
+    BOOST_CHECK (checkSinCos (angles));
+    // Large angles
+    for (std::size_t i=0; i<angles.size (); ++i) {
+      angles [i] = 2e4 * (rand () / (value_type) RAND_MAX - .5);
+      if (i % 2 == 0) angles [i] = (angles [i] < 0 ? -1e4 : 1e4) +
+			angles [i] * 1e-4;
+    }
+    BOOST_CHECK (checkSinCos (angles));
+  }
+  // Multiples of pi/2 and their neighbours at one ulp
+  std::vector <value_type> angles;
+  for (int k=-8; k<=8; ++k) {
+    const value_type angle (k * M_PI_2);
+    angles.push_back (angle);
+    angles.push_back (nextafter (angle, -HUGE_VAL));
+    angles.push_back (nextafter (angle, HUGE_VAL));
+  }
+  angles.push_back (-0.);
+  for (std::size_t l=0; l<7; ++l) {
+    std::vector <value_type> subset (angles.begin (),
+				     angles.begin () + lengths [l]);
+    BOOST_CHECK (checkSinCos (subset));
+  }
+  BOOST_CHECK (checkSinCos (angles));
+}
+
+BOOST_AUTO_TEST_CASE (incremental)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  Configuration_t q (robot->configSize ()), q1 (robot->configSize ());
+  shootRandomConfig (robot, q);
+  robot->currentConfiguration (q);
+  robot->computeForwardKinematics ();
+  for (size_type n=0; n<100; ++n) {
+    // Modify the configuration of one joint only
+    shootRandomConfig (robot, q1);
+    const JointPtr_t& joint (jv [n % jv.size ()]);
+    q.segment (joint->rankInConfiguration (), joint->configSize ()) =
+      q1.segment (joint->rankInConfiguration (), joint->configSize ());
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    // Compare with forward kinematics computed from scratch
+    DevicePtr_t reference = createRobot ();
+    reference->currentConfiguration (q);
+    reference->computeForwardKinematics ();
+    const JointVector_t& jvRef = reference->getJointVector ();
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      BOOST_CHECK (isApprox (jv [i]->currentTransformation (),
+			     jvRef [i]->currentTransformation ()));
+      BOOST_CHECK (jv [i]->jacobian ().isApprox (jvRef [i]->jacobian ()));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (device_data)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data [2] = {DeviceData::create (robot),
+			      DeviceData::create (robot)};
+  Configuration_t q [2] = {Configuration_t (robot->configSize ()),
+			   Configuration_t (robot->configSize ())};
+  for (size_type n=0; n<100; ++n) {
+    // Evaluate two configurations with the same device
+    for (size_type k=0; k<2; ++k) {
+      shootRandomConfig (robot, q [k]);
+      data [k]->currentConfiguration (q [k]);
+      robot->computeForwardKinematics (*data [k]);
+    }
+    for (size_type k=0; k<2; ++k) {
+      robot->currentConfiguration (q [k]);
+      robot->computeForwardKinematics ();
+      for (std::size_t i=0; i<jv.size (); ++i) {
+	BOOST_CHECK (isApprox (data [k]->position (jv [i]),
+			       jv [i]->currentTransformation ()));
+	BOOST_CHECK (data [k]->jacobian (jv [i]) == jv [i]->jacobian ());
+      }
+      BOOST_CHECK ((data [k]->positionCenterOfMass () -
+		    robot->positionCenterOfMass ()).length () < 1e-10);
+      BOOST_CHECK (data [k]->jacobianCenterOfMass () ==
+		   robot->jacobianCenterOfMass ());
+    }
+  }
+  // Joints that do not belong to the device
+  DevicePtr_t other = createRobot ();
+  BOOST_CHECK_THROW (data [0]->jacobian (other->getJointVector () [2]),
+		     std::runtime_error);
+  BOOST_CHECK_THROW (data [0]->sparseJacobian (other->getJointVector () [2]),
+		     std::runtime_error);
+  // Joint Jacobians are still stored in the device after a copy sharing
+  // the joints is destroyed.
+  robot->clone ();
+  for (std::size_t i=0; i<jv.size (); ++i) {
+    BOOST_CHECK (&jv [i]->jacobian () == &robot->data ().jacobian (jv [i]));
+  }
+}
+
+BOOST_AUTO_TEST_CASE (lazy_evaluation)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t lazy = DeviceData::create (robot);
+  DeviceDataPtr_t eager = DeviceData::create (robot);
+  lazy->controlComputation (Device::JOINT_POSITION);
+  eager->controlComputation (Device::ALL);
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    lazy->currentConfiguration (q);
+    eager->currentConfiguration (q);
+    robot->computeForwardKinematics (*lazy);
+    robot->computeForwardKinematics (*eager);
+    // Access quantities in an order different from forward kinematics
+    BOOST_CHECK (lazy->jacobianCenterOfMass () ==
+		 eager->jacobianCenterOfMass ());
+    BOOST_CHECK ((lazy->positionCenterOfMass () -
+		  eager->positionCenterOfMass ()).length () < 1e-10);
+    for (std::size_t i=jv.size (); i>0; --i) {
+      BOOST_CHECK (lazy->jacobian (jv [i-1]) == eager->jacobian (jv [i-1]));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (partial)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  // Leaves of both branches
+  JointVector_t targets [2];
+  targets [0].push_back (jv [4]);
+  targets [1].push_back (jv [4]);
+  targets [1].push_back (jv [7]);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  data->controlComputation (Device::JACOBIAN);
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<100; ++n) {
+    const JointVector_t& joints (targets [n % 2]);
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data, joints);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    for (std::size_t i=0; i<joints.size (); ++i) {
+      for (JointPtr_t joint = joints [i]; joint;
+	   joint = joint->parentJoint ()) {
+	BOOST_CHECK (isApprox (data->position (joint),
+			       joint->currentTransformation ()));
+      }
+      BOOST_CHECK (data->jacobian (joints [i]) == joints [i]->jacobian ());
+    }
+    // Complete forward kinematics after partial forward kinematics
+    if (n % 3 == 0) {
+      robot->computeForwardKinematics (*data);
+      for (std::size_t i=0; i<jv.size (); ++i) {
+	BOOST_CHECK (isApprox (data->position (jv [i]),
+			       jv [i]->currentTransformation ()));
+	BOOST_CHECK (data->jacobian (jv [i]) == jv [i]->jacobian ());
+      }
+    }
+  }
+  // Joints that do not belong to the device
+  DevicePtr_t other = createRobot ();
+  BOOST_CHECK_THROW (robot->computeForwardKinematics
+		     (*data, other->getJointVector ()), std::runtime_error);
+  // Partial forward kinematics of the device before any complete forward
+  // kinematics
+  const JointVector_t leaf (1, other->getJointVector () [7]);
+  shootRandomConfig (other, q);
+  other->currentConfiguration (q);
+  other->computeForwardKinematics (leaf);
+  DeviceDataPtr_t reference = DeviceData::create (other);
+  other->computeForwardKinematics (*reference);
+  for (JointPtr_t joint = leaf [0]; joint; joint = joint->parentJoint ()) {
+    BOOST_CHECK (isApprox (reference->position (joint),
+			   joint->currentTransformation ()));
+  }
+}
+
+BOOST_AUTO_TEST_CASE (sparse_jacobian)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  // Same robot with a joint of type JOINT_GENERIC
+  DevicePtr_t generic = createRobot (true);
+  const JointVector_t& gjv = generic->getJointVector ();
+  DeviceDataPtr_t gdata = DeviceData::create (generic);
+  Configuration_t q (robot->configSize ());
+  vector_t v (robot->numberDof ()), tau (robot->numberDof ());
+  vector6_t f, Jv;
+  JointJacobian_t dense;
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    f.setRandom ();
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    gdata->currentConfiguration (q);
+    generic->computeForwardKinematics (*gdata);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      const SparseJacobian& J (data->sparseJacobian (jv [i]));
+      const JointJacobian_t& reference (data->jacobian (jv [i]));
+      J.toDense (dense);
+      BOOST_CHECK (dense == reference);
+      gdata->sparseJacobian (gjv [i]).toDense (dense);
+      BOOST_CHECK ((dense - reference).norm () < 1e-10);
+      J.multiply (v, Jv);
+      BOOST_CHECK ((Jv - reference * v).norm () < 1e-10);
+      J.transposeMultiply (f, tau);
+      BOOST_CHECK ((tau - reference.transpose () * f).norm () < 1e-10);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (velocity)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  data->controlComputation (Device::VELOCITY);
+  // Same robot with joints of type JOINT_GENERIC
+  DevicePtr_t generic = createRobot (true);
+  const JointVector_t& gjv = generic->getJointVector ();
+  DeviceDataPtr_t gdata = DeviceData::create (generic);
+  gdata->controlComputation (Device::VELOCITY);
+  Configuration_t q (robot->configSize ());
+  vector_t v (robot->numberDof ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    data->currentConfiguration (q);
+    data->currentVelocity (v);
+    robot->computeForwardKinematics (*data);
+    gdata->currentConfiguration (q);
+    gdata->currentVelocity (v);
+    generic->computeForwardKinematics (*gdata);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      const vector6_t Jv (data->jacobian (jv [i]) * v);
+      const fcl::Vec3f& linear (data->linearVelocity (jv [i]));
+      const fcl::Vec3f& angular (data->angularVelocity (jv [i]));
+      for (size_type k=0; k<3; ++k) {
+	BOOST_CHECK (fabs (linear [k] - Jv [k]) < 1e-10);
+	BOOST_CHECK (fabs (angular [k] - Jv [k+3]) < 1e-10);
+      }
+      BOOST_CHECK ((gdata->linearVelocity (gjv [i]) - linear).norm () <
+		   1e-10);
+      BOOST_CHECK ((gdata->angularVelocity (gjv [i]) - angular).norm () <
+		   1e-10);
+    }
+    const vector_t Jcom (data->jacobianCenterOfMass () * v);
+    for (size_type k=0; k<3; ++k) {
+      BOOST_CHECK (fabs (data->velocityCenterOfMass () [k] - Jcom [k]) <
+		   1e-10);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (acceleration)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  DeviceDataPtr_t before = DeviceData::create (robot);
+  DeviceDataPtr_t after = DeviceData::create (robot);
+  data->controlComputation
+    (Device::Computation_t (Device::ACCELERATION | Device::COM));
+  // Same robot with joints of type JOINT_GENERIC
+  DevicePtr_t generic = createRobot (true);
+  const JointVector_t& gjv = generic->getJointVector ();
+  DeviceDataPtr_t gdata = DeviceData::create (generic);
+  gdata->controlComputation (Device::ACCELERATION);
+  const value_type h = 1e-6;
+  Configuration_t q (robot->configSize ()), qh (robot->configSize ());
+  vector_t v (robot->numberDof ()), a (robot->numberDof ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    a.setRandom ();
+    data->currentConfiguration (q);
+    data->currentVelocity (v);
+    data->currentAcceleration (a);
+    robot->computeForwardKinematics (*data);
+    gdata->currentConfiguration (q);
+    gdata->currentVelocity (v);
+    gdata->currentAcceleration (a);
+    generic->computeForwardKinematics (*gdata);
+    // Derivative of Jacobian times velocity by finite differences
+    hpp::model::integrate (robot, q, -h * v, qh);
+    before->currentConfiguration (qh);
+    robot->computeForwardKinematics (*before);
+    hpp::model::integrate (robot, q, h * v, qh);
+    after->currentConfiguration (qh);
+    robot->computeForwardKinematics (*after);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      const vector6_t dJv ((after->jacobian (jv [i]) * v -
+			    before->jacobian (jv [i]) * v) / (2 * h));
+      const vector6_t Ja (data->jacobian (jv [i]) * a);
+      for (size_type k=0; k<3; ++k) {
+	BOOST_CHECK (fabs (data->linearDrift (jv [i]) [k] - dJv [k]) < 1e-6);
+	BOOST_CHECK (fabs (data->angularDrift (jv [i]) [k] - dJv [k+3]) <
+		     1e-6);
+	BOOST_CHECK (fabs (data->linearAcceleration (jv [i]) [k] -
+			   data->linearDrift (jv [i]) [k] - Ja [k]) < 1e-10);
+	BOOST_CHECK (fabs (data->angularAcceleration (jv [i]) [k] -
+			   data->angularDrift (jv [i]) [k] - Ja [k+3]) <
+		     1e-10);
+      }
+      BOOST_CHECK ((gdata->linearAcceleration (gjv [i]) -
+		    data->linearAcceleration (jv [i])).norm () < 1e-10);
+      BOOST_CHECK ((gdata->angularAcceleration (gjv [i]) -
+		    data->angularAcceleration (jv [i])).norm () < 1e-10);
+      BOOST_CHECK ((gdata->linearDrift (gjv [i]) -
+		    data->linearDrift (jv [i])).norm () < 1e-10);
+      BOOST_CHECK ((gdata->angularDrift (gjv [i]) -
+		    data->angularDrift (jv [i])).norm () < 1e-10);
+    }
+    const vector_t dJcomv ((after->jacobianCenterOfMass () * v -
+			    before->jacobianCenterOfMass () * v) / (2 * h));
+    const vector_t Jcoma (data->jacobianCenterOfMass () * a);
+    for (size_type k=0; k<3; ++k) {
+      BOOST_CHECK (fabs (data->driftCenterOfMass () [k] - dJcomv [k]) <
+		   1e-6);
+      BOOST_CHECK (fabs (data->accelerationCenterOfMass () [k] -
+			 data->driftCenterOfMass () [k] - Jcoma [k]) < 1e-10);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (frame_jacobian)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  DeviceDataPtr_t after = DeviceData::create (robot);
+  const value_type h = 1e-6;
+  Configuration_t q (robot->configSize ()), qh (robot->configSize ());
+  vector_t v (robot->numberDof ());
+  Transform3f frame;
+  frame.setQuatRotation (Quaternion3f (.5, .5, -.5, .5));
+  frame.setTranslation (fcl::Vec3f (.3, -.1, .2));
+  matrix_t Jframe (6, robot->numberDof ()), Jpoint (3, robot->numberDof ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    hpp::model::integrate (robot, q, h * v, qh);
+    after->currentConfiguration (qh);
+    robot->computeForwardKinematics (*after);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      const Transform3f M0 (data->position (jv [i]) * frame);
+      const Transform3f M1 (after->position (jv [i]) * frame);
+      // Velocity of frame origin by finite differences
+      const fcl::Vec3f dp ((M1.getTranslation () - M0.getTranslation ()) *
+			   (1/h));
+      data->frameJacobian (jv [i], frame, DeviceData::WORLD, Jframe);
+      data->pointJacobian (jv [i], frame.getTranslation (), DeviceData::WORLD,
+			   Jpoint);
+      const vector_t Jv (Jframe * v), Jpv (Jpoint * v);
+      for (size_type k=0; k<3; ++k) {
+	BOOST_CHECK (fabs (Jv [k] - dp [k]) < 1e-5);
+	BOOST_CHECK (fabs (Jpv [k] - dp [k]) < 1e-5);
+      }
+      BOOST_CHECK (Jframe.bottomRows (3) ==
+		   data->jacobian (jv [i]).bottomRows (3));
+      // Local frame: rotate velocities of world frame.
+      const fcl::Matrix3f& R (M0.getRotation ());
+      data->frameJacobian (jv [i], frame, DeviceData::LOCAL, Jframe);
+      const vector_t Jlocal (Jframe * v);
+      for (size_type k=0; k<3; ++k) {
+	const value_type linear = R (0, k) * Jv [0] + R (1, k) * Jv [1] +
+	  R (2, k) * Jv [2];
+	const value_type angular = R (0, k) * Jv [3] + R (1, k) * Jv [4] +
+	  R (2, k) * Jv [5];
+	BOOST_CHECK (fabs (Jlocal [k] - linear) < 1e-10);
+	BOOST_CHECK (fabs (Jlocal [k+3] - angular) < 1e-10);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE (partial_center_of_mass)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  // Whole robot
+  CenterOfMassComputationPtr_t all = CenterOfMassComputation::create (robot);
+  all->add (robot->rootJoint ());
+  all->computeMass ();
+  // Both branches below the SO3 joint. The third joint already belongs to
+  // the subtree of the first one.
+  CenterOfMassComputationPtr_t branches =
+    CenterOfMassComputation::create (robot);
+  branches->add (jv [5]);
+  branches->add (jv [2]);
+  branches->add (jv [4]);
+  branches->computeMass ();
+  robot->controlComputation
+    (Device::Computation_t (Device::JACOBIAN | Device::COM));
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    all->compute ();
+    BOOST_CHECK (fabs (all->mass () - robot->mass ()) < 1e-10);
+    BOOST_CHECK ((all->com () - robot->positionCenterOfMass ()).length () <
+		 1e-10);
+    BOOST_CHECK (all->jacobian () == robot->jacobianCenterOfMass ());
+    branches->compute ();
+    value_type mass = 0;
+    fcl::Vec3f massCom (0, 0, 0);
+    for (std::size_t i=2; i<jv.size (); ++i) {
+      BodyPtr_t body = jv [i]->linkedBody ();
+      mass += body->mass ();
+      massCom += jv [i]->currentTransformation ().transform
+	(body->localCenterOfMass ()) * body->mass ();
+    }
+    BOOST_CHECK (fabs (branches->mass () - mass) < 1e-10);
+    BOOST_CHECK ((branches->com () - massCom * (1/mass)).length () < 1e-10);
+    // Same computation from a DeviceData at another configuration
+    const fcl::Vec3f com (branches->com ());
+    shootRandomConfig (robot, q);
+    robot->currentConfiguration (q);
+    robot->computeForwardKinematics ();
+    branches->compute (*data);
+    BOOST_CHECK ((branches->com () - com).length () < 1e-10);
+    all->compute (*data);
+    BOOST_CHECK ((all->com () - data->positionCenterOfMass ()).length () <
+		 1e-10);
+    BOOST_CHECK (all->jacobian () == data->jacobianCenterOfMass ());
+  }
+  DevicePtr_t other = createRobot ();
+  BOOST_CHECK_THROW (all->add (other->rootJoint ()), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE (centroidal_momentum)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DynamicsPtr_t dynamics = Dynamics::create (robot);
+  DynamicsPtr_t before = Dynamics::create (robot);
+  DynamicsPtr_t after = Dynamics::create (robot);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  const value_type h = 1e-6;
+  Configuration_t q (robot->configSize ()), qh (robot->configSize ());
+  vector_t v (robot->numberDof ()), a (robot->numberDof ());
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    a.setRandom ();
+    dynamics->computeCentroidalMomentum (q, v);
+    const vector6_t& momentum (dynamics->centroidalMomentum ());
+    BOOST_CHECK (dynamics->centroidalMomentumMatrix ().cols () ==
+		 robot->numberDof ());
+    // Sum of the momenta of the bodies
+    data->currentConfiguration (q);
+    data->currentVelocity (v);
+    data->currentAcceleration (a);
+    robot->computeForwardKinematics (*data);
+    const fcl::Vec3f& com (data->positionCenterOfMass ());
+    fcl::Vec3f linear (0, 0, 0), angular (0, 0, 0);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      BodyPtr_t body = jv [i]->linkedBody ();
+      const Transform3f& M (data->position (jv [i]));
+      const fcl::Vec3f c (M.transform (body->localCenterOfMass ()));
+      const fcl::Vec3f& omega (data->angularVelocity (jv [i]));
+      const fcl::Vec3f vc (data->linearVelocity (jv [i]) +
+			   omega.cross (c - M.getTranslation ()));
+      const hpp::model::matrix3_t& R (M.getRotation ());
+      const fcl::Vec3f Iomega
+	(R * (body->inertiaMatrix () * (R.transposeTimes (omega))));
+      linear += vc * body->mass ();
+      angular += (c - com).cross (vc * body->mass ()) + Iomega;
+    }
+    for (size_type k=0; k<3; ++k) {
+      BOOST_CHECK (fabs (momentum [k] - linear [k]) < 1e-10);
+      BOOST_CHECK (fabs (momentum [k+3] - angular [k]) < 1e-10);
+      BOOST_CHECK (fabs (momentum [k] / robot->mass () -
+			 data->velocityCenterOfMass () [k]) < 1e-10);
+    }
+    // Derivative of momentum matrix times velocity by finite differences
+    hpp::model::integrate (robot, q, -h * v, qh);
+    before->computeCentroidalMomentum (qh, v);
+    hpp::model::integrate (robot, q, h * v, qh);
+    after->computeCentroidalMomentum (qh, v);
+    const vector6_t dAv ((after->centroidalMomentum () -
+			  before->centroidalMomentum ()) / (2 * h));
+    for (size_type k=0; k<6; ++k) {
+      BOOST_CHECK (fabs (dynamics->centroidalMomentumBias () [k] - dAv [k]) <
+		   1e-6);
+    }
+    const fcl::Vec3f acom (dynamics->accelerationCenterOfMass (a));
+    for (size_type k=0; k<3; ++k) {
+      BOOST_CHECK (fabs (acom [k] - data->accelerationCenterOfMass () [k]) <
+		   1e-10);
+    }
+  }
+}
+
+// Kinetic plus potential energy of the robot
+value_type energy (const DevicePtr_t& robot, ConfigurationIn_t q,
+		   vectorIn_t v, const fcl::Vec3f& gravity)
+{
+  const JointVector_t& jv = robot->getJointVector ();
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  data->currentConfiguration (q);
+  data->currentVelocity (v);
+  robot->computeForwardKinematics (*data);
+  value_type result = 0;
+  for (std::size_t i=0; i<jv.size (); ++i) {
+    BodyPtr_t body = jv [i]->linkedBody ();
+    const Transform3f& M (data->position (jv [i]));
+    const fcl::Vec3f c (M.transform (body->localCenterOfMass ()));
+    const fcl::Vec3f& omega (data->angularVelocity (jv [i]));
+    const fcl::Vec3f vc (data->linearVelocity (jv [i]) +
+			 omega.cross (c - M.getTranslation ()));
+    const fcl::Vec3f omegaLocal (M.getRotation ().transposeTimes (omega));
+    result += .5 * (body->mass () * vc.dot (vc) +
+		    omegaLocal.dot (body->inertiaMatrix () * omegaLocal)) -
+      body->mass () * gravity.dot (c);
+  }
+  return result;
+}
+
+BOOST_AUTO_TEST_CASE (inverse_dynamics)
+{
+  DevicePtr_t robot = createRobot ();
+  DynamicsPtr_t dynamics = Dynamics::create (robot);
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  const value_type h = 1e-5;
+  const fcl::Vec3f& g (dynamics->gravity ());
+  Configuration_t q (robot->configSize ()), qh (robot->configSize ());
+  vector_t v (robot->numberDof ()), a (robot->numberDof ()),
+    zero (vector_t::Zero (robot->numberDof ()));
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    a.setRandom ();
+    dynamics->computeInverseDynamics (q, v, a);
+    const vector_t tau (dynamics->torques ());
+    // Power of the joint torques is the derivative of the energy.
+    hpp::model::integrate (robot, q, -h * v + (h * h / 2) * a, qh);
+    const value_type e0 (energy (robot, qh, v - h * a, g));
+    hpp::model::integrate (robot, q, h * v + (h * h / 2) * a, qh);
+    const value_type e1 (energy (robot, qh, v + h * a, g));
+    BOOST_CHECK (fabs (tau.dot (v) - (e1 - e0) / (2 * h)) < 1e-6);
+    // The root joint is a translation along the world axes: its torques
+    // accelerate the center of mass against gravity.
+    data->currentConfiguration (q);
+    data->currentVelocity (v);
+    data->currentAcceleration (a);
+    robot->computeForwardKinematics (*data);
+    const fcl::Vec3f force ((data->accelerationCenterOfMass () - g) *
+			    robot->mass ());
+    for (size_type k=0; k<3; ++k) {
+      BOOST_CHECK (fabs (tau [k] - force [k]) < 1e-10);
+    }
+    // Gravity compensation
+    dynamics->computeInverseDynamics (q, zero, zero);
+    const vector_t gravityTorques (dynamics->torques ());
+    dynamics->computeGravityTorques (q);
+    BOOST_CHECK ((dynamics->torques () - gravityTorques).norm () < 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (mass_matrix)
+{
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  DynamicsPtr_t dynamics = Dynamics::create (robot);
+  // Same robot with a joint of type JOINT_GENERIC
+  DynamicsPtr_t generic = Dynamics::create (createRobot (true));
+  const size_type nv = robot->numberDof ();
+  Configuration_t q (robot->configSize ());
+  vector_t v (nv), a (nv);
+  matrix_t x (nv, 2);
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    a.setRandom ();
+    dynamics->computeInverseDynamics (q, v, a);
+    const vector_t tau (dynamics->torques ());
+    dynamics->computeInverseDynamics (q, v, vector_t::Zero (nv));
+    const vector_t bias (dynamics->torques ());
+    dynamics->computeMassMatrix (q);
+    const matrix_t& M (dynamics->massMatrix ());
+    generic->computeMassMatrix (q);
+    BOOST_CHECK ((generic->massMatrix () - M).norm () < 1e-10);
+    BOOST_CHECK ((M - M.transpose ()).norm () < 1e-12);
+    BOOST_CHECK ((M * a + bias - tau).norm () < 1e-10);
+    BOOST_CHECK (fabs (.5 * v.dot (M * v) -
+		       energy (robot, q, v, fcl::Vec3f (0, 0, 0))) < 1e-10);
+    // Degrees of freedom of different branches are not coupled.
+    const size_type branch1 = jv [2]->rankInVelocity ();
+    const size_type branch2 = jv [6]->rankInVelocity ();
+    BOOST_CHECK (M (branch1, branch2) == 0);
+    BOOST_CHECK (M (branch2, branch1) == 0);
+    dynamics->factorizeMassMatrix ();
+    x.col (0) = M * a;
+    x.col (1) = M * v;
+    dynamics->solveMassMatrix (x);
+    BOOST_CHECK ((x.col (0) - a).norm () < 1e-10);
+    BOOST_CHECK ((x.col (1) - v).norm () < 1e-10);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (forward_dynamics)
+{
+  DevicePtr_t robot = createRobot ();
+  DynamicsPtr_t dynamics = Dynamics::create (robot);
+  const size_type nv = robot->numberDof ();
+  const value_type dt = 1e-3;
+  Configuration_t q (robot->configSize ()), q1 (robot->configSize ());
+  vector_t v (nv), tau (nv), v1 (nv);
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    v.setRandom ();
+    tau.setRandom ();
+    dynamics->computeForwardDynamics (q, v, tau);
+    const vector_t a (dynamics->acceleration ());
+    dynamics->computeInverseDynamics (q, v, a);
+    BOOST_CHECK ((dynamics->torques () - tau).norm () < 1e-9);
+    // Gravity compensation keeps the robot at rest.
+    dynamics->computeGravityTorques (q);
+    const vector_t gravityTorques (dynamics->torques ());
+    dynamics->computeForwardDynamics (q, vector_t::Zero (nv), gravityTorques);
+    BOOST_CHECK (dynamics->acceleration ().norm () < 1e-9);
+    // Semi-implicit Euler step
+    q1 = q; v1 = v;
+    dynamics->step (q1, v1, tau, dt);
+    BOOST_CHECK ((v1 - v - a * dt).norm () < 1e-12);
+    hpp::model::integrate (robot, q, v1 * dt, q);
+    BOOST_CHECK ((q1 - q).norm () < 1e-12);
+  }
+}
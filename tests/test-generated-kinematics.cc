@@ -0,0 +1,109 @@
+///
+/// Copyright (c) 2016 CNRS
+///
+///
+// This file is part of hpp-model
+// hpp-model is free software: you can redistribute it
+// and/or modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation, either version
+// 3 of the License, or (at your option) any later version.
+//
+// hpp-model is distributed in the hope that it will be
+// useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+// of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Lesser Public License for more details.  You should have
+// received a copy of the GNU Lesser General Public License along with
+// hpp-model  If not, see
+// <http://www.gnu.org/licenses/>.
+
+// This test
+//   - generates the kinematics of a robot with KinematicsGenerator (see
+//     generate-kinematics.cc),
+//   - randomly samples configurations,
+//   - checks that the generated code gives the same joint positions,
+//     Jacobians and center of mass as the device.
+
+#define BOOST_TEST_MODULE TEST_GENERATED_KINEMATICS
+#include <boost/test/unit_test.hpp>
+
+#include <hpp/util/debug.hh>
+#include <hpp/model/configuration.hh>
+#include <hpp/model/device-data.hh>
+#include <hpp/model/joint.hh>
+#include "generated-kinematics-robot.hh"
+#include "generated-kinematics.hh"
+
+using hpp::model::ComJacobian_t;
+using hpp::model::Configuration_t;
+using hpp::model::DeviceData;
+using hpp::model::DeviceDataPtr_t;
+using hpp::model::DevicePtr_t;
+using hpp::model::JointJacobian_t;
+using hpp::model::JointVector_t;
+using hpp::model::Transform3f;
+using hpp::model::size_type;
+using hpp::model::value_type;
+
+void shootRandomConfig (const DevicePtr_t& robot, Configuration_t& config)
+{
+  JointVector_t jv = robot->getJointVector ();
+  for (JointVector_t::const_iterator itJoint = jv.begin ();
+       itJoint != jv.end (); itJoint++) {
+    std::size_t rank = (*itJoint)->rankInConfiguration ();
+    (*itJoint)->configuration ()->uniformlySample (rank, config);
+  }
+}
+
+BOOST_AUTO_TEST_CASE (generated_kinematics)
+{
+  typedef hpp::model::test::RobotKinematics <value_type> Kinematics_t;
+  typedef hpp::model::test::RobotKinematics <float> KinematicsFloat_t;
+  DevicePtr_t robot = createRobot ();
+  const JointVector_t& jv = robot->getJointVector ();
+  BOOST_CHECK (Kinematics_t::configSize == robot->configSize ());
+  BOOST_CHECK (Kinematics_t::numberDof == robot->numberDof ());
+  BOOST_CHECK (Kinematics_t::numberJoints == (size_type) jv.size ());
+  const size_type nv = Kinematics_t::numberDof;
+  const size_type nJoints = Kinematics_t::numberJoints;
+
+  DeviceDataPtr_t data = DeviceData::create (robot);
+  Configuration_t q (robot->configSize ());
+  std::vector <value_type> M (12 * nJoints), J (6 * nv * nJoints),
+    Jcom (3 * nv), com (3);
+  std::vector <float> qf (robot->configSize ()), Mf (12 * nJoints);
+  for (size_type n=0; n<100; ++n) {
+    shootRandomConfig (robot, q);
+    data->currentConfiguration (q);
+    robot->computeForwardKinematics (*data);
+    Kinematics_t::forwardKinematics (q.data (), &M [0]);
+    Kinematics_t::jacobians (&M [0], &J [0]);
+    Kinematics_t::centerOfMass (&M [0], &com [0]);
+    Kinematics_t::jacobianCenterOfMass (&M [0], &Jcom [0]);
+    for (size_type i=0; i<q.size (); ++i) qf [i] = (float) q [i];
+    KinematicsFloat_t::forwardKinematics (&qf [0], &Mf [0]);
+    for (std::size_t i=0; i<jv.size (); ++i) {
+      const size_type rank = jv [i]->rankInTree ();
+      const Transform3f& position (data->position (jv [i]));
+      for (size_type r=0; r<3; ++r) {
+	for (size_type c=0; c<3; ++c) {
+	  BOOST_CHECK (fabs (M [12*rank+3*r+c] -
+			     position.getRotation () (r, c)) < 1e-10);
+	  BOOST_CHECK (fabs (Mf [12*rank+3*r+c] -
+			     position.getRotation () (r, c)) < 1e-4);
+	}
+	BOOST_CHECK (fabs (M [12*rank+9+r] -
+			   position.getTranslation () [r]) < 1e-10);
+	BOOST_CHECK (fabs (Mf [12*rank+9+r] -
+			   position.getTranslation () [r]) < 1e-4);
+      }
+      Eigen::Map <const JointJacobian_t> jacobian (&J [6*nv*rank], 6, nv);
+      BOOST_CHECK (jacobian.isApprox (data->jacobian (jv [i]), 1e-10));
+    }
+    for (size_type r=0; r<3; ++r) {
+      BOOST_CHECK (fabs (com [r] - data->positionCenterOfMass () [r]) <
+		   1e-10);
+    }
+    Eigen::Map <const ComJacobian_t> jacobianCom (&Jcom [0], 3, nv);
+    BOOST_CHECK (jacobianCom.isApprox (data->jacobianCenterOfMass (), 1e-10));
+  }
+}